@@ -0,0 +1,143 @@
+#ifndef MATHEMATICS_BATCH_HPP
+#define MATHEMATICS_BATCH_HPP
+
+#include <immintrin.h>
+#include <cstddef>
+#include "float3.hpp"
+#include "float4.hpp"
+#include "float4x4.hpp"
+#include "profile.hpp"
+#include "soa.hpp"
+
+namespace mathsimd {
+
+    /* Array kernels over float3/float4 data. Each step transposes 8 vectors into SoA
+     * registers, works on whole registers and transposes back. float3 is 16 bytes,
+     * so it shares the float4 path with its padding lane cleared on output. */
+    namespace detail {
+
+        /* Runs kernel(src, dst) over 8 vectors at a time, staging the tail through scratch
+         * buffers. src and dst may be the same array. */
+        template<typename In, typename Out, typename F>
+        inline void for_each_vector8(In const *src, Out *dst, std::size_t count, F &&kernel) {
+            std::size_t n = 0;
+            for (; n + LANES <= count; n += LANES) {
+                kernel(src[n], &dst[n].x());
+            }
+            if (n < count) {
+                In in[LANES]{};
+                Out out[LANES];
+                copy_vectors(src + n, in, count - n);
+                kernel(in[0], &out[0].x());
+                copy_vectors(out, dst + n, count - n);
+            }
+        }
+
+        inline void transform8(float4x4 const &m, __m256 const v[4], __m256 out[4]) {
+            for (int r = 0; r < 4; ++r) {
+                __m256 acc = _mm256_mul_ps(_mm256_broadcast_ss(m[0] + r), v[0]);
+                acc = _mm256_fmadd_ps(_mm256_broadcast_ss(m[1] + r), v[1], acc);
+                acc = _mm256_fmadd_ps(_mm256_broadcast_ss(m[2] + r), v[2], acc);
+                out[r] = _mm256_fmadd_ps(_mm256_broadcast_ss(m[3] + r), v[3], acc);
+            }
+        }
+
+        /* 1 / sqrt(len2) refined by one Newton step; zero length maps to zero */
+        inline __m256 inverse_length(__m256 len2) {
+            __m256 const y = _mm256_rsqrt_ps(len2);
+            __m256 const half_len2_y2 = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), len2), _mm256_mul_ps(y, y));
+            __m256 const refined = _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f), half_len2_y2));
+            return _mm256_and_ps(refined, _mm256_cmp_ps(len2, _mm256_setzero_ps(), _CMP_GT_OQ));
+        }
+
+        /* Copies the vectors whose xyz lies inside [lo, hi] to the front of out, keeping their
+         * order. Survivors only ever move towards the front, so out may be in. */
+        template<typename T>
+        inline std::size_t cull(T const *in, T *out, std::size_t count, float3 const &lo, float3 const &hi) {
+            __m256 const lx = _mm256_set1_ps(lo.x()), ly = _mm256_set1_ps(lo.y()), lz = _mm256_set1_ps(lo.z());
+            __m256 const hx = _mm256_set1_ps(hi.x()), hy = _mm256_set1_ps(hi.y()), hz = _mm256_set1_ps(hi.z());
+            std::size_t kept = 0;
+            auto keep = [&](float const *src, std::size_t first, std::size_t valid) {
+                __m256 x, y, z, w;
+                load_xyzw(src, x, y, z, w);
+                __m256 inside = _mm256_and_ps(_mm256_cmp_ps(x, lx, _CMP_GE_OQ), _mm256_cmp_ps(x, hx, _CMP_LE_OQ));
+                inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(y, ly, _CMP_GE_OQ), _mm256_cmp_ps(y, hy, _CMP_LE_OQ)));
+                inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(z, lz, _CMP_GE_OQ), _mm256_cmp_ps(z, hz, _CMP_LE_OQ)));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(inside)) & ((1u << valid) - 1);
+                for (; mask; mask &= mask - 1) {
+                    copy_vectors(in + first + _tzcnt_u32(mask), out + kept++, 1);
+                }
+            };
+            std::size_t n = 0;
+            for (; n + LANES <= count; n += LANES) {
+                keep(in[n], n, LANES);
+            }
+            if (n < count) {
+                T tail[LANES]{};
+                copy_vectors(in + n, tail, count - n);
+                keep(tail[0], n, count - n);
+            }
+            return kept;
+        }
+    }
+
+    /* out[i] = matmul(m, in[i]) */
+    inline void transform(float4x4 const &m, float4 const *in, float4 *out, std::size_t count) {
+        MATHSIMD_PROFILE_SCOPE("transform float4", count);
+        detail::for_each_vector8(in, out, count, [&](float const *src, float *dst) {
+            __m256 v[4], r[4];
+            detail::load_xyzw(src, v[0], v[1], v[2], v[3]);
+            detail::transform8(m, v, r);
+            detail::store_xyzw(r[0], r[1], r[2], r[3], dst);
+        });
+    }
+
+    /* Transforms points (w = 1) by an affine matrix: out[i] = (m * float4(in[i], 1)).xyz */
+    inline void transform_points(float4x4 const &m, float3 const *in, float3 *out, std::size_t count) {
+        MATHSIMD_PROFILE_SCOPE("transform points", count);
+        detail::for_each_vector8(in, out, count, [&](float const *src, float *dst) {
+            __m256 v[4], r[4];
+            detail::load_xyzw(src, v[0], v[1], v[2], v[3]);
+            v[3] = _mm256_set1_ps(1.f);
+            detail::transform8(m, v, r);
+            detail::store_xyzw(r[0], r[1], r[2], _mm256_setzero_ps(), dst);
+        });
+    }
+
+    /* out[i] = in[i].normalized(), except that zero vectors stay zero */
+    inline void normalize(float3 const *in, float3 *out, std::size_t count) {
+        MATHSIMD_PROFILE_SCOPE("normalize float3", count);
+        detail::for_each_vector8(in, out, count, [&](float const *src, float *dst) {
+            __m256 x, y, z, w;
+            detail::load_xyzw(src, x, y, z, w);
+            __m256 const inv = detail::inverse_length(_mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z))));
+            detail::store_xyzw(_mm256_mul_ps(x, inv), _mm256_mul_ps(y, inv), _mm256_mul_ps(z, inv), _mm256_setzero_ps(), dst);
+        });
+    }
+
+    inline void normalize(float4 const *in, float4 *out, std::size_t count) {
+        MATHSIMD_PROFILE_SCOPE("normalize float4", count);
+        detail::for_each_vector8(in, out, count, [&](float const *src, float *dst) {
+            __m256 x, y, z, w;
+            detail::load_xyzw(src, x, y, z, w);
+            __m256 const len2 = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_fmadd_ps(z, z, _mm256_mul_ps(w, w))));
+            __m256 const inv = detail::inverse_length(len2);
+            detail::store_xyzw(_mm256_mul_ps(x, inv), _mm256_mul_ps(y, inv), _mm256_mul_ps(z, inv), _mm256_mul_ps(w, inv), dst);
+        });
+    }
+
+    /* Keeps the vectors inside the box [lo, hi] (w is ignored), packed at the front of
+     * out in their original order; returns how many were kept. out may be in. */
+    inline std::size_t cull(float3 const *in, float3 *out, std::size_t count, float3 const &lo, float3 const &hi) {
+        MATHSIMD_PROFILE_SCOPE("cull float3", count);
+        return detail::cull(in, out, count, lo, hi);
+    }
+
+    inline std::size_t cull(float4 const *in, float4 *out, std::size_t count, float3 const &lo, float3 const &hi) {
+        MATHSIMD_PROFILE_SCOPE("cull float4", count);
+        return detail::cull(in, out, count, lo, hi);
+    }
+
+}
+
+#endif //MATHEMATICS_BATCH_HPP
@@ -0,0 +1,211 @@
+#ifndef MATHEMATICS_DECOMPOSITION_HPP
+#define MATHEMATICS_DECOMPOSITION_HPP
+
+#include <immintrin.h>
+#include <cstddef>
+#include "float3.hpp"
+#include "float3x3.hpp"
+#include "soa.hpp"
+
+namespace mathsimd {
+
+    /* Batched 3x3 decompositions. The kernels work on 8 matrices at once in SoA
+     * form: a[e] holds column-major element e of every matrix, one per lane. */
+    namespace detail {
+
+        struct lanes3 {
+            __m256 x, y, z;
+        };
+
+        inline lanes3 column(__m256 const m[9], int c) { return {m[3 * c], m[3 * c + 1], m[3 * c + 2]}; }
+
+        inline void set_column(__m256 m[9], int c, lanes3 const &v) {
+            m[3 * c] = v.x;
+            m[3 * c + 1] = v.y;
+            m[3 * c + 2] = v.z;
+        }
+
+        inline __m256 dot(lanes3 const &a, lanes3 const &b) {
+            return _mm256_fmadd_ps(a.x, b.x, _mm256_fmadd_ps(a.y, b.y, _mm256_mul_ps(a.z, b.z)));
+        }
+
+        inline lanes3 cross(lanes3 const &a, lanes3 const &b) {
+            return {_mm256_fmsub_ps(a.y, b.z, _mm256_mul_ps(a.z, b.y)),
+                    _mm256_fmsub_ps(a.z, b.x, _mm256_mul_ps(a.x, b.z)),
+                    _mm256_fmsub_ps(a.x, b.y, _mm256_mul_ps(a.y, b.x))};
+        }
+
+        inline lanes3 scale(lanes3 const &a, __m256 s) {
+            return {_mm256_mul_ps(a.x, s), _mm256_mul_ps(a.y, s), _mm256_mul_ps(a.z, s)};
+        }
+
+        inline lanes3 blend(lanes3 const &a, lanes3 const &b, __m256 mask) {
+            return {_mm256_blendv_ps(a.x, b.x, mask), _mm256_blendv_ps(a.y, b.y, mask), _mm256_blendv_ps(a.z, b.z, mask)};
+        }
+
+        inline lanes3 normalized(lanes3 const &a) {
+            return scale(a, _mm256_div_ps(_mm256_set1_ps(1.f), _mm256_sqrt_ps(dot(a, a))));
+        }
+
+        /* Columns p and q after the rotation [c s; -s c]: (c*p - s*q, s*p + c*q) */
+        inline void rotate(lanes3 &p, lanes3 &q, __m256 c, __m256 s) {
+            lanes3 const t = p;
+            p = {_mm256_fnmadd_ps(s, q.x, _mm256_mul_ps(c, t.x)),
+                 _mm256_fnmadd_ps(s, q.y, _mm256_mul_ps(c, t.y)),
+                 _mm256_fnmadd_ps(s, q.z, _mm256_mul_ps(c, t.z))};
+            q = {_mm256_fmadd_ps(s, t.x, _mm256_mul_ps(c, q.x)),
+                 _mm256_fmadd_ps(s, t.y, _mm256_mul_ps(c, q.y)),
+                 _mm256_fmadd_ps(s, t.z, _mm256_mul_ps(c, q.z))};
+        }
+
+        /* One Hestenes step: orthogonalise columns p and q of b, applying the same
+         * rotation to v. Returns the mask of lanes that actually rotated. */
+        inline __m256 jacobi_step(lanes3 &bp, lanes3 &bq, lanes3 &vp, lanes3 &vq) {
+            __m256 const one = _mm256_set1_ps(1.f);
+            __m256 const sign_bit = _mm256_set1_ps(-0.f);
+            __m256 const tolerance = _mm256_set1_ps(EPSILON_F);
+            __m256 const alpha = dot(bp, bp);
+            __m256 const beta = dot(bq, bq);
+            __m256 const gamma = dot(bp, bq);
+            // |gamma| against the product of the norms, not gamma^2 against alpha * beta, which
+            // would raise the entries to the 4th power
+            __m256 const bound = _mm256_mul_ps(tolerance, _mm256_mul_ps(_mm256_sqrt_ps(alpha), _mm256_sqrt_ps(beta)));
+            __m256 const active = _mm256_cmp_ps(_mm256_andnot_ps(sign_bit, gamma), bound, _CMP_GT_OQ);
+            __m256 const zeta = _mm256_div_ps(_mm256_sub_ps(beta, alpha), _mm256_add_ps(gamma, gamma));
+            __m256 const abs_zeta = _mm256_andnot_ps(sign_bit, zeta);
+            __m256 t = _mm256_div_ps(one, _mm256_add_ps(abs_zeta, _mm256_sqrt_ps(_mm256_fmadd_ps(zeta, zeta, one))));
+            t = _mm256_or_ps(t, _mm256_and_ps(sign_bit, zeta));
+            __m256 c = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_fmadd_ps(t, t, one)));
+            __m256 s = _mm256_mul_ps(c, t);
+            c = _mm256_blendv_ps(one, c, active);
+            s = _mm256_and_ps(s, active);
+            rotate(bp, bq, c, s);
+            rotate(vp, vq, c, s);
+            return active;
+        }
+
+        /* Orders columns p and q by decreasing norm. Swapping two columns of v would
+         * turn it into a reflection, so the moved column is negated in both b and v. */
+        inline void sort_step(lanes3 &bp, lanes3 &bq, lanes3 &vp, lanes3 &vq) {
+            __m256 const sign_bit = _mm256_set1_ps(-0.f);
+            __m256 const swap = _mm256_cmp_ps(dot(bq, bq), dot(bp, bp), _CMP_GT_OQ);
+            __m256 const flip = _mm256_and_ps(swap, sign_bit);
+            lanes3 const b = bp, v = vp;
+            bp = blend(bp, bq, swap);
+            vp = blend(vp, vq, swap);
+            bq = blend(bq, b, swap);
+            vq = blend(vq, v, swap);
+            bq = {_mm256_xor_ps(bq.x, flip), _mm256_xor_ps(bq.y, flip), _mm256_xor_ps(bq.z, flip)};
+            vq = {_mm256_xor_ps(vq.x, flip), _mm256_xor_ps(vq.y, flip), _mm256_xor_ps(vq.z, flip)};
+        }
+    }
+
+    /* Signed SVD of 8 matrices: a = u * diag(s) * v^T where u and v are proper
+     * rotations and s[0] >= s[1] >= |s[2]|. A reflection in a shows up as s[2] < 0. */
+    inline void svd8(__m256 const a[9], __m256 u[9], __m256 s[3], __m256 v[9]) {
+        using namespace detail;
+        constexpr int max_sweeps = 8;
+        __m256 const zero = _mm256_setzero_ps();
+        __m256 const one = _mm256_set1_ps(1.f);
+        __m256 const sign_bit = _mm256_set1_ps(-0.f);
+        __m256 const exponent_bits = _mm256_castsi256_ps(_mm256_set1_epi32(0x7f800000));
+
+        // divide every lane by the power of two just below its largest entry, which is exact,
+        // so that squared norms stay in range whatever the scale of a; s is scaled back below.
+        // Zero, denormal and non-finite lanes have no usable exponent and stay unscaled.
+        __m256 largest = zero;
+        for (int e = 0; e < 9; ++e) { largest = _mm256_max_ps(largest, _mm256_andnot_ps(sign_bit, a[e])); }
+        __m256 const exponent = _mm256_and_ps(largest, exponent_bits);
+        __m256 const scalable = _mm256_and_ps(_mm256_cmp_ps(exponent, zero, _CMP_NEQ_OQ),
+                                              _mm256_cmp_ps(exponent, exponent_bits, _CMP_NEQ_OQ));
+        __m256 const magnitude = _mm256_blendv_ps(one, exponent, scalable);
+        __m256 const inverse = _mm256_div_ps(one, magnitude);
+
+        lanes3 b[3]{scale(column(a, 0), inverse), scale(column(a, 1), inverse), scale(column(a, 2), inverse)};
+        lanes3 w[3]{{one, zero, zero}, {zero, one, zero}, {zero, zero, one}};
+
+        for (int sweep = 0; sweep < max_sweeps; ++sweep) {
+            __m256 rotated = jacobi_step(b[0], b[1], w[0], w[1]);
+            rotated = _mm256_or_ps(rotated, jacobi_step(b[0], b[2], w[0], w[2]));
+            rotated = _mm256_or_ps(rotated, jacobi_step(b[1], b[2], w[1], w[2]));
+            if (_mm256_testz_ps(rotated, rotated)) break;
+        }
+
+        sort_step(b[0], b[1], w[0], w[1]);
+        sort_step(b[0], b[2], w[0], w[2]);
+        sort_step(b[1], b[2], w[1], w[2]);
+
+        // the columns of b are now mutually orthogonal with norms s; normalise them into u,
+        // completing the basis where the matrix is rank deficient, i.e. s[1] <= EPSILON_F * s[0]
+        __m256 const n0 = dot(b[0], b[0]);
+        __m256 const n1 = dot(b[1], b[1]);
+        __m256 const rank_threshold = _mm256_mul_ps(n0, _mm256_set1_ps(EPSILON_F * EPSILON_F));
+        lanes3 u0 = blend({one, zero, zero}, normalized(b[0]), _mm256_cmp_ps(n0, zero, _CMP_GT_OQ));
+        lanes3 u1 = normalized(b[1]);
+        __m256 const proj = dot(u1, u0);
+        u1 = normalized({_mm256_fnmadd_ps(proj, u0.x, u1.x), _mm256_fnmadd_ps(proj, u0.y, u1.y), _mm256_fnmadd_ps(proj, u0.z, u1.z)});
+        __m256 const use_x = _mm256_cmp_ps(_mm256_mul_ps(u0.x, u0.x), _mm256_mul_ps(u0.y, u0.y), _CMP_LE_OQ);
+        lanes3 const axis{_mm256_and_ps(use_x, one), _mm256_andnot_ps(use_x, one), zero};
+        u1 = blend(normalized(cross(u0, axis)), u1, _mm256_cmp_ps(n1, rank_threshold, _CMP_GT_OQ));
+        lanes3 const u2 = cross(u0, u1);
+
+        s[0] = _mm256_mul_ps(_mm256_sqrt_ps(n0), magnitude);
+        s[1] = _mm256_mul_ps(_mm256_sqrt_ps(n1), magnitude);
+        s[2] = _mm256_mul_ps(dot(b[2], u2), magnitude);
+        set_column(u, 0, u0);
+        set_column(u, 1, u1);
+        set_column(u, 2, u2);
+        for (int c = 0; c < 3; ++c) {
+            set_column(v, c, w[c]);
+        }
+    }
+
+    /* Polar decomposition of 8 matrices: a = r * p with r a proper rotation and p
+     * symmetric. When det(a) < 0 the reflection is kept in p rather than in r. */
+    inline void polar8(__m256 const a[9], __m256 r[9], __m256 p[9]) {
+        __m256 u[9], s[3], v[9];
+        svd8(a, u, s, v);
+        for (int j = 0; j < 3; ++j) {
+            for (int i = 0; i < 3; ++i) {
+                __m256 rij = _mm256_mul_ps(u[i], v[j]);
+                __m256 vs = _mm256_mul_ps(v[i], s[0]);
+                __m256 pij = _mm256_mul_ps(vs, v[j]);
+                for (int k = 1; k < 3; ++k) {
+                    rij = _mm256_fmadd_ps(u[3 * k + i], v[3 * k + j], rij);
+                    vs = _mm256_mul_ps(v[3 * k + i], s[k]);
+                    pij = _mm256_fmadd_ps(vs, v[3 * k + j], pij);
+                }
+                r[3 * j + i] = rij;
+                p[3 * j + i] = pij;
+            }
+        }
+    }
+
+    inline void svd(float3x3 const *a, float3x3 *u, float3 *s, float3x3 *v, std::size_t count) {
+        using namespace detail;
+        constexpr identity_pad<3> pad;
+        for_each_batch(count, [&](std::size_t first, std::size_t lanes) {
+            __m256 m[9], mu[9], ms[3], mv[9];
+            load_soa<9>(a[first], stride_of<float3x3>(), lanes, m, pad.val);
+            svd8(m, mu, ms, mv);
+            store_soa<9>(mu, lanes, u[first], stride_of<float3x3>());
+            store_soa<9>(mv, lanes, v[first], stride_of<float3x3>());
+            store_soa<3>(ms, lanes, &s[first].x(), stride_of<float3>());
+        });
+    }
+
+    inline void polar(float3x3 const *a, float3x3 *r, float3x3 *p, std::size_t count) {
+        using namespace detail;
+        constexpr identity_pad<3> pad;
+        for_each_batch(count, [&](std::size_t first, std::size_t lanes) {
+            __m256 m[9], mr[9], mp[9];
+            load_soa<9>(a[first], stride_of<float3x3>(), lanes, m, pad.val);
+            polar8(m, mr, mp);
+            store_soa<9>(mr, lanes, r[first], stride_of<float3x3>());
+            store_soa<9>(mp, lanes, p[first], stride_of<float3x3>());
+        });
+    }
+
+}
+
+#endif //MATHEMATICS_DECOMPOSITION_HPP
@@ -0,0 +1,48 @@
+#ifndef MATHEMATICS_SIMD_FLOAT2X2_HPP
+#define MATHEMATICS_SIMD_FLOAT2X2_HPP
+
+#include <immintrin.h>
+#include "float2.hpp"
+#include "constants.hpp"
+
+namespace mathsimd {
+
+  struct float2x2 {
+  private:
+    alignas(16) float _val[4]{0.f, 0.f, 0.f, 0.f};
+  public:
+    float2x2() = default;
+    float2x2(float2x2 const &other) { _mm_store_ps(_val, _mm_load_ps(other._val)); }
+    float2x2(float2 const &c0, float2 const &c1) : _val{c0.x(), c0.y(), c1.x(), c1.y()} {}
+    float2x2(__m128 const &m) { _mm_store_ps(_val, m); }
+    inline float const* operator[](size_t i) const { return _val + 2 * i; }
+    inline float* operator[](size_t i) { return _val + 2 * i; }
+    inline operator float const*() const { return _val; }
+    inline operator float*() { return _val; }
+    inline operator __m128() const { return _mm_load_ps(_val); }
+
+    float2 c0() const { return float2(_val); }
+    float2 c1() const { return float2(_val + 2); }
+
+#define ARITHMETIC(OP)							\
+    friend float2x2 operator OP (float2x2 const &a, float2x2 const &b); \
+    friend float2x2 operator OP (float const &a, float2x2 const &b);	\
+    friend float2x2 operator OP (float2x2 const &a, float const &b);
+    ARITHMETIC(+)
+    ARITHMETIC(-)
+    ARITHMETIC(*)
+#undef ARITHMETIC
+    friend float2x2 operator / (float2x2 const &a, float const &b);
+    friend float2x2 fast_div(float2x2 const &a, float const &b);
+    friend float2x2 reciprocal(float2x2 const &a);
+
+    friend float2x2 matmul(float2x2 const &a, float2x2 const &b);
+    friend float2 matmul(float2x2 const &a, float2 const &b);
+
+    static inline float2x2 identity() { return {float2::right(), float2::up()}; }
+
+  };
+
+}
+
+#endif
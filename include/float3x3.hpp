@@ -0,0 +1,63 @@
+#ifndef MATHEMATICS_SIMD_FLOAT3X3_HPP
+#define MATHEMATICS_SIMD_FLOAT3X3_HPP
+
+#include <immintrin.h>
+#include "float2.hpp"
+#include "float3.hpp"
+#include "constants.hpp"
+
+namespace mathsimd {
+
+  /* Column-major and tightly packed: the nine elements sit in 36 bytes, so the
+   * first eight go through one 256-bit register and the ninth through a scalar op. */
+  struct float3x3 {
+  private:
+    float _val[9]{0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+  public:
+    float3x3() = default;
+    float3x3(float3x3 const &other) {
+      _mm256_storeu_ps(_val, _mm256_loadu_ps(other._val));
+      _val[8] = other._val[8];
+    }
+    float3x3(float3 const &c0, float3 const &c1, float3 const &c2)
+      : _val{c0.x(), c0.y(), c0.z(), c1.x(), c1.y(), c1.z(), c2.x(), c2.y(), c2.z()} {}
+    float3x3(__m256 const &a, float const &b) {
+      _mm256_storeu_ps(_val, a);
+      _val[8] = b;
+    }
+    inline float3x3 &operator=(float3x3 const &other) {
+      _mm256_storeu_ps(_val, _mm256_loadu_ps(other._val));
+      _val[8] = other._val[8];
+      return *this;
+    }
+    inline float const* operator[](size_t i) const { return _val + 3 * i; }
+    inline float* operator[](size_t i) { return _val + 3 * i; }
+    inline operator float const*() const { return _val; }
+    inline operator float*() { return _val; }
+
+    float3 c0() const { return {_val[0], _val[1], _val[2]}; }
+    float3 c1() const { return {_val[3], _val[4], _val[5]}; }
+    float3 c2() const { return {_val[6], _val[7], _val[8]}; }
+
+#define ARITHMETIC(OP)							\
+    friend float3x3 operator OP (float3x3 const &a, float3x3 const &b); \
+    friend float3x3 operator OP (float const &a, float3x3 const &b);	\
+    friend float3x3 operator OP (float3x3 const &a, float const &b);
+    ARITHMETIC(+)
+    ARITHMETIC(-)
+    ARITHMETIC(*)
+#undef ARITHMETIC
+    friend float3x3 operator / (float3x3 const &a, float const &b);
+    friend float3x3 fast_div(float3x3 const &a, float const &b);
+    friend float3x3 reciprocal(float3x3 const &a);
+
+    friend float3x3 matmul(float3x3 const &a, float3x3 const &b);
+    friend float3 matmul(float3x3 const &a, float3 const &b);
+
+    static inline float3x3 identity() { return {float3::right(), float3::up(), float3::forward()}; }
+
+  };
+
+}
+
+#endif
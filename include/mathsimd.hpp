@@ -6,7 +6,16 @@
 #include "float2.hpp"
 #include "float4.hpp"
 #include "float4x4.hpp"
+#include "float2x2.hpp"
+#include "float3x3.hpp"
+#include "float4x4_batch.hpp"
+#include "batch.hpp"
+#include "profile.hpp"
+#include "decomposition.hpp"
+#include "solve.hpp"
 #include "random.hpp"
+#include "morton.hpp"
+#include "stream.hpp"
 
 
 #endif //MATHEMATICS_MATHSIMD_HPP
@@ -0,0 +1,240 @@
+#ifndef MATHEMATICS_MORTON_HPP
+#define MATHEMATICS_MORTON_HPP
+
+#include <immintrin.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "float3.hpp"
+#include "soa.hpp"
+
+namespace mathsimd {
+
+    /* Z-curve ordering of float3 data: quantise positions into Morton codes, radix
+     * sort the (code, index) pairs and reorder the attribute arrays with the result,
+     * so that points close in space end up close in memory. */
+    namespace detail {
+
+        /* Spreads the low 10 bits of every lane so that there are two zero bits between each */
+        inline __m256i spread_bits(__m256i v) {
+            v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 16)), _mm256_set1_epi32(0x030000ff));
+            v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 8)), _mm256_set1_epi32(0x0300f00f));
+            v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 4)), _mm256_set1_epi32(0x030c30c3));
+            v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 2)), _mm256_set1_epi32(0x09249249));
+            return v;
+        }
+
+        /* Maps 8 positions onto the integer grid [0, max_cell] on every axis */
+        inline void quantise(float const *src, float3 const &lo, __m256 const scale[3], int max_cell, __m256i q[3]) {
+            __m256 p[4];
+            load_xyzw(src, p[0], p[1], p[2], p[3]);
+            __m256i const top = _mm256_set1_epi32(max_cell);
+            for (int a = 0; a < 3; ++a) {
+                __m256 const offset = _mm256_sub_ps(p[a], _mm256_set1_ps(static_cast<float const *>(lo)[a]));
+                __m256i const cell = _mm256_cvttps_epi32(_mm256_mul_ps(offset, scale[a]));
+                q[a] = _mm256_min_epi32(_mm256_max_epi32(cell, _mm256_setzero_si256()), top);
+            }
+        }
+
+        template<typename Key>
+        struct morton_traits;
+
+        template<>
+        struct morton_traits<uint32_t> {
+            static constexpr int bits = 10;
+
+            static inline void encode(__m256i const q[3], uint32_t *out) {
+                __m256i code = spread_bits(q[0]);
+                code = _mm256_or_si256(code, _mm256_slli_epi32(spread_bits(q[1]), 1));
+                code = _mm256_or_si256(code, _mm256_slli_epi32(spread_bits(q[2]), 2));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), code);
+            }
+        };
+
+        template<>
+        struct morton_traits<uint64_t> {
+            static constexpr int bits = 21;
+
+            static inline void encode(__m256i const q[3], uint64_t *out) {
+                alignas(32) uint32_t cells[3][LANES];
+                for (int a = 0; a < 3; ++a) {
+                    _mm256_store_si256(reinterpret_cast<__m256i *>(cells[a]), q[a]);
+                }
+                for (std::size_t l = 0; l < LANES; ++l) {
+                    out[l] = _pdep_u64(cells[0][l], 0x1249249249249249ull)
+                           | _pdep_u64(cells[1][l], 0x2492492492492492ull)
+                           | _pdep_u64(cells[2][l], 0x4924924924924924ull);
+                }
+            }
+        };
+
+        template<typename F>
+        inline void run_parallel(unsigned threads, F &&task) {
+            std::vector<std::thread> workers;
+            workers.reserve(threads - 1);
+            for (unsigned t = 1; t < threads; ++t) {
+                workers.emplace_back(task, t);
+            }
+            task(0u);
+            for (auto &w : workers) {
+                w.join();
+            }
+        }
+    }
+
+    inline void bounds(float3 const *points, std::size_t count, float3 &lo, float3 &hi) {
+        if (!count) {
+            lo = hi = float3::zero();
+            return;
+        }
+        __m128 mn = static_cast<__m128>(points[0]);
+        __m128 mx = mn;
+        for (std::size_t i = 1; i < count; ++i) {
+            __m128 const p = static_cast<__m128>(points[i]);
+            mn = _mm_min_ps(mn, p);
+            mx = _mm_max_ps(mx, p);
+        }
+        lo = mn;
+        hi = mx;
+    }
+
+    /* Morton codes of points quantised inside [lo, hi]: 30 bit codes for uint32_t
+     * keys (10 bits per axis) and 63 bit codes for uint64_t keys (21 bits per axis) */
+    template<typename Key>
+    inline void morton_encode(float3 const *points, std::size_t count, float3 const &lo, float3 const &hi, Key *keys) {
+        using traits = detail::morton_traits<Key>;
+        constexpr int max_cell = (1 << traits::bits) - 1;
+        __m256 scale[3];
+        for (int a = 0; a < 3; ++a) {
+            float const extent = static_cast<float const *>(hi)[a] - static_cast<float const *>(lo)[a];
+            scale[a] = _mm256_set1_ps(extent > 0.f ? max_cell / extent : 0.f);
+        }
+
+        __m256i q[3];
+        std::size_t n = 0;
+        for (; n + detail::LANES <= count; n += detail::LANES) {
+            detail::quantise(points[n], lo, scale, max_cell, q);
+            traits::encode(q, keys + n);
+        }
+        if (n < count) {
+            float3 tmp[detail::LANES];
+            Key out[detail::LANES];
+            detail::copy_vectors(points + n, tmp, count - n);
+            detail::quantise(tmp[0], lo, scale, max_cell, q);
+            traits::encode(q, out);
+            std::copy(out, out + (count - n), keys + n);
+        }
+    }
+
+    /* Stable LSD radix sort of keys, carrying values along, one byte per pass.
+     * Passes whose byte is the same for every key are skipped. */
+    template<typename Key>
+    inline void radix_sort(Key *keys, uint32_t *values, std::size_t count, unsigned threads = 1) {
+        constexpr int passes = sizeof(Key);
+        constexpr std::size_t min_per_thread = 1 << 16;
+        using histogram = std::array<std::size_t, 256>;
+
+        threads = static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(threads, count / min_per_thread)));
+        std::size_t const chunk = (count + threads - 1) / threads;
+
+        std::array<histogram, passes> total{};
+        for (std::size_t i = 0; i < count; ++i) {
+            for (int p = 0; p < passes; ++p) {
+                ++total[p][(keys[i] >> (8 * p)) & 0xff];
+            }
+        }
+
+        std::vector<Key> key_tmp(count);
+        std::vector<uint32_t> value_tmp(count);
+        Key *src_keys = keys, *dst_keys = key_tmp.data();
+        uint32_t *src_values = values, *dst_values = value_tmp.data();
+        std::vector<histogram> offsets(threads);
+
+        for (int p = 0; p < passes; ++p) {
+            int const shift = 8 * p;
+            if (std::find(total[p].begin(), total[p].end(), count) != total[p].end()) continue;
+
+            if (threads == 1) {
+                offsets[0] = total[p];
+            } else {
+                detail::run_parallel(threads, [&](unsigned t) {
+                    histogram &h = offsets[t];
+                    h.fill(0);
+                    std::size_t const end = std::min(count, (t + 1) * chunk);
+                    for (std::size_t i = t * chunk; i < end; ++i) {
+                        ++h[(src_keys[i] >> shift) & 0xff];
+                    }
+                });
+            }
+            // exclusive prefix sum over (digit, thread) so that equal digits keep their order
+            std::size_t sum = 0;
+            for (int d = 0; d < 256; ++d) {
+                for (unsigned t = 0; t < threads; ++t) {
+                    std::size_t const c = offsets[t][d];
+                    offsets[t][d] = sum;
+                    sum += c;
+                }
+            }
+            detail::run_parallel(threads, [&](unsigned t) {
+                histogram &o = offsets[t];
+                std::size_t const end = std::min(count, (t + 1) * chunk);
+                for (std::size_t i = t * chunk; i < end; ++i) {
+                    std::size_t const dst = o[(src_keys[i] >> shift) & 0xff]++;
+                    dst_keys[dst] = src_keys[i];
+                    dst_values[dst] = src_values[i];
+                }
+            });
+            std::swap(src_keys, dst_keys);
+            std::swap(src_values, dst_values);
+        }
+
+        if (src_keys != keys) {
+            std::copy(src_keys, src_keys + count, keys);
+            std::copy(src_values, src_values + count, values);
+        }
+    }
+
+    /* dst[i] = src[order[i]] */
+    template<typename T>
+    inline void gather(T const *src, uint32_t const *order, T *dst, std::size_t count) {
+        constexpr std::size_t distance = 16;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (i + distance < count) {
+                _mm_prefetch(reinterpret_cast<char const *>(src + order[i + distance]), _MM_HINT_T0);
+            }
+            dst[i] = src[order[i]];
+        }
+    }
+
+    /* dst[order[i]] = src[i], the inverse of gather */
+    template<typename T>
+    inline void scatter(T const *src, uint32_t const *order, T *dst, std::size_t count) {
+        constexpr std::size_t distance = 16;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (i + distance < count) {
+                _mm_prefetch(reinterpret_cast<char const *>(dst + order[i + distance]), _MM_HINT_T0);
+            }
+            dst[order[i]] = src[i];
+        }
+    }
+
+    /* The permutation that puts points in Morton order: gather(attr, order, ...) reorders
+     * any per-point attribute array to match */
+    template<typename Key = uint32_t>
+    inline void morton_order(float3 const *points, std::size_t count, uint32_t *order, unsigned threads = 1) {
+        float3 lo, hi;
+        bounds(points, count, lo, hi);
+        std::vector<Key> keys(count);
+        morton_encode(points, count, lo, hi, keys.data());
+        for (std::size_t i = 0; i < count; ++i) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        radix_sort(keys.data(), order, count, threads);
+    }
+
+}
+
+#endif //MATHEMATICS_MORTON_HPP
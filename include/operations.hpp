@@ -4,6 +4,8 @@
 #include "float3.hpp"
 #include "float4.hpp"
 #include "float4x4.hpp"
+#include "float2x2.hpp"
+#include "float3x3.hpp"
 #include "bool.hpp"
 #include <iostream>
 namespace mathsimd {
@@ -202,5 +204,103 @@ RECIPROCAL(TYPE)
         return _mm256_castps256_ps128(b0);
     }
 
+
+    /* float2x2 operations */
+    #define ARITHMETIC(OP) \
+        inline float2x2 operator OP (float2x2 const &a, float2x2 const &b) { \
+            return float2x2(_mm_load_ps(a._val) OP _mm_load_ps(b._val)); \
+        } \
+        inline float2x2 operator OP (float const &a, float2x2 const &b) { \
+            return float2x2(_mm_broadcast_ss(&a) OP _mm_load_ps(b._val)); \
+        } \
+        inline float2x2 operator OP (float2x2 const &a, float const &b) { \
+            return float2x2(_mm_load_ps(a._val) OP _mm_broadcast_ss(&b)); \
+        }
+    ARITHMETIC(+)
+    ARITHMETIC(-)
+    ARITHMETIC(*)
+    #undef ARITHMETIC
+    inline float2x2 operator / (float2x2 const &a, float const &b) {
+        return float2x2(_mm_div_ps(_mm_load_ps(a._val), _mm_broadcast_ss(&b)));
+    }
+
+    inline float2x2 fast_div(float2x2 const &a, float const &b) {
+        return float2x2(_mm_mul_ps(_mm_load_ps(a._val), _mm_rcp_ps(_mm_broadcast_ss(&b))));
+    }
+
+    inline float2x2 reciprocal(float2x2 const &a) {
+        return float2x2(_mm_rcp_ps(_mm_load_ps(a._val)));
+    }
+
+    inline float2x2 matmul(float2x2 const &a, float2x2 const &b) {
+        __m128 const l = _mm_load_ps(a._val);
+        __m128 const r = _mm_load_ps(b._val);
+        __m128 out;
+        out = _mm_mul_ps(_mm_movelh_ps(l, l), _mm_permute_ps(r, _MM_SHUFFLE(2,2,0,0)));
+        out = _mm_fmadd_ps(_mm_movehl_ps(l, l), _mm_permute_ps(r, _MM_SHUFFLE(3,3,1,1)), out);
+        return float2x2(out);
+    }
+
+    inline float2 matmul(float2x2 const &a, float2 const &b) {
+        __m128 const l = _mm_load_ps(a._val);
+        __m128 out = _mm_mul_ps(l, _mm_permute_ps(static_cast<__m128>(b), _MM_SHUFFLE(1,1,0,0)));
+        return _mm_add_ps(out, _mm_movehl_ps(out, out));
+    }
+
+    /* float3x3 operations */
+    #define ARITHMETIC(OP) \
+        inline float3x3 operator OP (float3x3 const &a, float3x3 const &b) { \
+            return float3x3(_mm256_loadu_ps(a._val) OP _mm256_loadu_ps(b._val), a._val[8] OP b._val[8]); \
+        } \
+        inline float3x3 operator OP (float const &a, float3x3 const &b) { \
+            return float3x3(_mm256_broadcast_ss(&a) OP _mm256_loadu_ps(b._val), a OP b._val[8]); \
+        } \
+        inline float3x3 operator OP (float3x3 const &a, float const &b) { \
+            return float3x3(_mm256_loadu_ps(a._val) OP _mm256_broadcast_ss(&b), a._val[8] OP b); \
+        }
+    ARITHMETIC(+)
+    ARITHMETIC(-)
+    ARITHMETIC(*)
+    #undef ARITHMETIC
+    inline float3x3 operator / (float3x3 const &a, float const &b) {
+        return float3x3(_mm256_div_ps(_mm256_loadu_ps(a._val), _mm256_broadcast_ss(&b)), a._val[8] / b);
+    }
+
+    inline float3x3 fast_div(float3x3 const &a, float const &b) {
+        auto mb = _mm256_rcp_ps(_mm256_broadcast_ss(&b));
+        return float3x3(_mm256_mul_ps(_mm256_loadu_ps(a._val), mb), a._val[8] * _mm256_cvtss_f32(mb));
+    }
+
+    inline float3x3 reciprocal(float3x3 const &a) {
+        return float3x3(_mm256_rcp_ps(_mm256_loadu_ps(a._val)), _mm_cvtss_f32(_mm_rcp_ss(_mm_load_ss(a._val + 8))));
+    }
+
+    inline float3x3 matmul(float3x3 const &a, float3x3 const &b) {
+        __m128i const tail = _mm_setr_epi32(-1, -1, -1, 0);
+        __m128 const l[3]{_mm_loadu_ps(a._val), _mm_loadu_ps(a._val + 3), _mm_maskload_ps(a._val + 6, tail)};
+        __m128 out[3];
+        for (int j = 0; j < 3; ++j) {
+            out[j] = _mm_mul_ps(l[0], _mm_broadcast_ss(b._val + 3 * j));
+            out[j] = _mm_fmadd_ps(l[1], _mm_broadcast_ss(b._val + 3 * j + 1), out[j]);
+            out[j] = _mm_fmadd_ps(l[2], _mm_broadcast_ss(b._val + 3 * j + 2), out[j]);
+        }
+        // columns overlap by one lane, so the stores must go in order
+        float3x3 c;
+        _mm_storeu_ps(c._val, out[0]);
+        _mm_storeu_ps(c._val + 3, out[1]);
+        _mm_maskstore_ps(c._val + 6, tail, out[2]);
+        return c;
+    }
+
+    inline float3 matmul(float3x3 const &a, float3 const &b) {
+        __m128i const tail = _mm_setr_epi32(-1, -1, -1, 0);
+        __m128 const v = static_cast<__m128>(b);
+        __m128 out;
+        out = _mm_mul_ps(_mm_loadu_ps(a._val), _mm_permute_ps(v, 0x00));
+        out = _mm_fmadd_ps(_mm_loadu_ps(a._val + 3), _mm_permute_ps(v, 0x55), out);
+        out = _mm_fmadd_ps(_mm_maskload_ps(a._val + 6, tail), _mm_permute_ps(v, 0xaa), out);
+        return out;
+    }
+
 }
 #endif //MATHEMATICS_OPERATIONS_HPP
@@ -0,0 +1,421 @@
+#ifndef MATHEMATICS_PROFILE_HPP
+#define MATHEMATICS_PROFILE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <x86intrin.h>
+#endif
+
+/* Kernel instrumentation. Library kernels open a MATHSIMD_PROFILE_SCOPE, which
+ * compiles to nothing unless MATHSIMD_PROFILE is defined. When enabled, every
+ * thread records into its own buffer without locking; report() and
+ * write_chrome_trace() aggregate the buffers of all threads. When a thread exits,
+ * its totals and events are folded into the registry and its buffer is freed.
+ *
+ * A scope reads the clock twice and, when hardware counters are available, reads
+ * them twice as well: with rdpmc through the mapped perf page where the kernel
+ * allows it (tens of cycles), otherwise with one read() syscall each time (around
+ * a microsecond). Instrument calls that do much more work than that. */
+#ifdef MATHSIMD_PROFILE
+#define MATHSIMD_PROFILE_CONCAT_(a, b) a##b
+#define MATHSIMD_PROFILE_CONCAT(a, b) MATHSIMD_PROFILE_CONCAT_(a, b)
+#define MATHSIMD_PROFILE_SCOPE(NAME, ELEMENTS) \
+    static mathsimd::profile::kernel const MATHSIMD_PROFILE_CONCAT(_profile_kernel_, __LINE__)(NAME); \
+    mathsimd::profile::scope const MATHSIMD_PROFILE_CONCAT(_profile_scope_, __LINE__)(MATHSIMD_PROFILE_CONCAT(_profile_kernel_, __LINE__), (ELEMENTS))
+#else
+#define MATHSIMD_PROFILE_SCOPE(NAME, ELEMENTS) ((void)0)
+#endif
+
+namespace mathsimd {
+namespace profile {
+
+    constexpr std::size_t MAX_KERNELS = 64;
+    /* default number of trace events kept per thread, see set_event_capacity() */
+    constexpr std::size_t MAX_EVENTS = 1 << 16;
+
+    enum counter { CYCLES, INSTRUCTIONS, CACHE_MISSES, COUNTERS };
+
+    /* Hardware counters of the calling thread, opened as one perf_event group.
+     * Every value reads as zero when perf_event_open is unavailable. */
+    struct hardware_counters {
+    private:
+        int _fd[COUNTERS]{-1, -1, -1};
+#ifdef __linux__
+        perf_event_mmap_page *_page[COUNTERS]{};
+#endif
+    public:
+        hardware_counters() {
+#ifdef __linux__
+            static constexpr uint64_t config[COUNTERS]{PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+            for (int c = 0; c < COUNTERS; ++c) {
+                perf_event_attr attr{};
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = config[c];
+                attr.disabled = c == 0;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP;
+                _fd[c] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, c == 0 ? -1 : _fd[0], 0));
+                if (_fd[c] < 0) {
+                    close_all();
+                    return;
+                }
+                // only needed for rdpmc; read() still works if the mapping fails
+                void *page = mmap(nullptr, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)), PROT_READ, MAP_SHARED, _fd[c], 0);
+                _page[c] = page == MAP_FAILED ? nullptr : static_cast<perf_event_mmap_page *>(page);
+            }
+            ioctl(_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+        }
+        hardware_counters(hardware_counters const &) = delete;
+        hardware_counters &operator=(hardware_counters const &) = delete;
+        ~hardware_counters() { close_all(); }
+
+        bool available() const { return _fd[0] >= 0; }
+
+        std::array<uint64_t, COUNTERS> read() const {
+            std::array<uint64_t, COUNTERS> out{};
+#ifdef __linux__
+            if (!available()) { return out; }
+            bool mapped = true;
+            for (int c = 0; c < COUNTERS && mapped; ++c) {
+                mapped = _page[c] && read_mapped(_page[c], out[c]);
+            }
+            if (mapped) { return out; }
+            struct { uint64_t nr; uint64_t values[COUNTERS]; } group{};
+            if (::read(_fd[0], &group, sizeof(group)) == sizeof(group)) {
+                for (int c = 0; c < COUNTERS; ++c) { out[c] = group.values[c]; }
+            } else {
+                out = {};
+            }
+#endif
+            return out;
+        }
+
+    private:
+#ifdef __linux__
+        /* The user space read protocol of perf_event_mmap_page: offset plus the live PMC,
+         * retried while the kernel updates the page. False when rdpmc cannot be used,
+         * e.g. while the group is not scheduled on the PMU. */
+        static bool read_mapped(perf_event_mmap_page const *page, uint64_t &value) {
+            auto const *pc = const_cast<perf_event_mmap_page const volatile *>(page);
+            uint32_t sequence;
+            do {
+                sequence = pc->lock;
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                uint32_t const index = pc->index;
+                if (!pc->cap_user_rdpmc || !index) { return false; }
+                int const shift = 64 - pc->pmc_width;
+                int64_t const pmc = static_cast<int64_t>(static_cast<uint64_t>(__rdpmc(static_cast<int>(index - 1))) << shift) >> shift;
+                value = static_cast<uint64_t>(pc->offset + pmc);
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            } while (pc->lock != sequence);
+            return true;
+        }
+#endif
+
+        void close_all() {
+#ifdef __linux__
+            for (int c = 0; c < COUNTERS; ++c) {
+                if (_page[c]) { munmap(_page[c], static_cast<std::size_t>(sysconf(_SC_PAGESIZE))); }
+                if (_fd[c] >= 0) { close(_fd[c]); }
+                _page[c] = nullptr;
+                _fd[c] = -1;
+            }
+#endif
+        }
+    };
+
+    struct totals {
+        uint64_t calls{0};
+        uint64_t elements{0};
+        uint64_t nanoseconds{0};
+        uint64_t counters[COUNTERS]{0, 0, 0};
+    };
+
+    struct event {
+        uint32_t kernel;
+        uint64_t elements;
+        int64_t start_ns;
+        int64_t duration_ns;
+    };
+
+    namespace detail {
+        inline std::atomic<std::size_t> &event_capacity() {
+            static std::atomic<std::size_t> capacity{MAX_EVENTS};
+            return capacity;
+        }
+
+        template<typename T>
+        inline void add(std::atomic<T> &a, T v) { a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed); }
+    }
+
+    /* Trace events kept per thread, for threads that have not recorded yet; 0 keeps totals only */
+    inline void set_event_capacity(std::size_t events) {
+        detail::event_capacity().store(events, std::memory_order_relaxed);
+    }
+
+    /* Written only by its owning thread; the atomics let report() read it from
+     * another thread without tearing, using relaxed loads and stores only */
+    struct thread_buffer {
+        uint64_t const thread_id;
+        hardware_counters counters;
+        std::atomic<uint64_t> calls[MAX_KERNELS]{};
+        std::atomic<uint64_t> elements[MAX_KERNELS]{};
+        std::atomic<uint64_t> nanoseconds[MAX_KERNELS]{};
+        std::atomic<uint64_t> hardware[MAX_KERNELS][COUNTERS]{};
+        /* allocated on the first recorded event; published before recorded counts it */
+        std::atomic<event *> events{nullptr};
+        std::size_t capacity{0};
+        std::atomic<std::size_t> recorded{0};
+        std::atomic<uint64_t> dropped{0};
+
+        explicit thread_buffer(uint64_t id) : thread_id(id) {}
+        thread_buffer(thread_buffer const &) = delete;
+        thread_buffer &operator=(thread_buffer const &) = delete;
+        ~thread_buffer() { delete[] events.load(std::memory_order_relaxed); }
+
+        void record(event const &e) {
+            event *buffer = events.load(std::memory_order_relaxed);
+            if (!buffer) {
+                capacity = detail::event_capacity().load(std::memory_order_relaxed);
+                if (capacity) {
+                    buffer = new event[capacity];
+                    events.store(buffer, std::memory_order_release);
+                }
+            }
+            std::size_t const n = recorded.load(std::memory_order_relaxed);
+            if (n < capacity) {
+                buffer[n] = e;
+                recorded.store(n + 1, std::memory_order_release);
+            } else {
+                detail::add(dropped, uint64_t{1});
+            }
+        }
+    };
+
+    namespace detail {
+        struct traced_event {
+            uint64_t thread_id;
+            event e;
+        };
+
+        struct registry {
+            std::mutex lock;
+            std::vector<char const *> names;
+            /* threads that are still running */
+            std::vector<std::unique_ptr<thread_buffer>> threads;
+            /* what exited threads recorded; events are kept up to event_capacity() in total */
+            totals retired[MAX_KERNELS]{};
+            std::vector<traced_event> retired_events;
+            uint64_t retired_dropped{0};
+            uint64_t next_thread_id{0};
+            bool counters_available{false};
+        };
+
+        /* Never destroyed, so that threads exiting during static destruction can still retire */
+        inline registry &global() {
+            static registry *r = new registry;
+            return *r;
+        }
+
+        inline int64_t now_ns() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /* Folds an exiting thread's buffer into the registry and frees it, closing its counters */
+        inline void retire(thread_buffer *buffer) {
+            auto &r = global();
+            std::lock_guard<std::mutex> guard(r.lock);
+            for (std::size_t k = 0; k < r.names.size(); ++k) {
+                totals &t = r.retired[k];
+                t.calls += buffer->calls[k].load(std::memory_order_relaxed);
+                t.elements += buffer->elements[k].load(std::memory_order_relaxed);
+                t.nanoseconds += buffer->nanoseconds[k].load(std::memory_order_relaxed);
+                for (int c = 0; c < COUNTERS; ++c) {
+                    t.counters[c] += buffer->hardware[k][c].load(std::memory_order_relaxed);
+                }
+            }
+            std::size_t const n = buffer->recorded.load(std::memory_order_relaxed);
+            std::size_t const room = event_capacity().load(std::memory_order_relaxed);
+            std::size_t const kept = r.retired_events.size() < room ? std::min(n, room - r.retired_events.size()) : 0;
+            for (std::size_t i = 0; i < kept; ++i) {
+                r.retired_events.push_back({buffer->thread_id, buffer->events.load(std::memory_order_relaxed)[i]});
+            }
+            r.retired_dropped += buffer->dropped.load(std::memory_order_relaxed) + (n - kept);
+            for (auto it = r.threads.begin(); it != r.threads.end(); ++it) {
+                if (it->get() == buffer) {
+                    r.threads.erase(it);
+                    break;
+                }
+            }
+        }
+
+        struct thread_handle {
+            thread_buffer *buffer{nullptr};
+            ~thread_handle() {
+                if (buffer) { retire(buffer); }
+            }
+        };
+    }
+
+    /* This thread's buffer; registering it is the only locked step and happens once per thread */
+    inline thread_buffer &local() {
+        thread_local detail::thread_handle handle;
+        if (!handle.buffer) {
+            auto &r = detail::global();
+            std::lock_guard<std::mutex> guard(r.lock);
+            r.threads.push_back(std::make_unique<thread_buffer>(r.next_thread_id++));
+            handle.buffer = r.threads.back().get();
+            r.counters_available |= handle.buffer->counters.available();
+        }
+        return *handle.buffer;
+    }
+
+    /* Threads that have recorded and are still running */
+    inline std::size_t live_threads() {
+        auto &r = detail::global();
+        std::lock_guard<std::mutex> guard(r.lock);
+        return r.threads.size();
+    }
+
+    /* A named instrumentation site, registered once on first use */
+    struct kernel {
+        uint32_t const id;
+        explicit kernel(char const *name) : id(register_name(name)) {}
+    private:
+        static uint32_t register_name(char const *name) {
+            auto &r = detail::global();
+            std::lock_guard<std::mutex> guard(r.lock);
+            for (std::size_t i = 0; i < r.names.size(); ++i) {
+                if (std::string_view(r.names[i]) == name) { return static_cast<uint32_t>(i); }
+            }
+            if (r.names.size() == MAX_KERNELS) { return MAX_KERNELS - 1; }
+            r.names.push_back(name);
+            return static_cast<uint32_t>(r.names.size() - 1);
+        }
+    };
+
+    /* Times one kernel call and charges it to the calling thread */
+    struct scope {
+    private:
+        thread_buffer &_buffer;
+        uint32_t _kernel;
+        uint64_t _elements;
+        int64_t _start;
+        std::array<uint64_t, COUNTERS> _counters;
+    public:
+        scope(kernel const &k, std::size_t elements)
+            : _buffer(local()), _kernel(k.id), _elements(elements),
+              _counters(_buffer.counters.read()) {
+            _start = detail::now_ns();
+        }
+        scope(scope const &) = delete;
+        scope &operator=(scope const &) = delete;
+        ~scope() {
+            int64_t const end = detail::now_ns();
+            auto const counters = _buffer.counters.read();
+            detail::add(_buffer.calls[_kernel], uint64_t{1});
+            detail::add(_buffer.elements[_kernel], _elements);
+            detail::add(_buffer.nanoseconds[_kernel], static_cast<uint64_t>(end - _start));
+            for (int c = 0; c < COUNTERS; ++c) {
+                detail::add(_buffer.hardware[_kernel][c], counters[c] - _counters[c]);
+            }
+            _buffer.record({_kernel, _elements, _start, end - _start});
+        }
+    };
+
+    /* Per-kernel totals summed over every thread that has recorded so far, running or not */
+    inline std::vector<std::pair<char const *, totals>> summary() {
+        auto &r = detail::global();
+        std::lock_guard<std::mutex> guard(r.lock);
+        std::vector<std::pair<char const *, totals>> out;
+        for (std::size_t k = 0; k < r.names.size(); ++k) {
+            totals t = r.retired[k];
+            for (auto const &b : r.threads) {
+                t.calls += b->calls[k].load(std::memory_order_relaxed);
+                t.elements += b->elements[k].load(std::memory_order_relaxed);
+                t.nanoseconds += b->nanoseconds[k].load(std::memory_order_relaxed);
+                for (int c = 0; c < COUNTERS; ++c) {
+                    t.counters[c] += b->hardware[k][c].load(std::memory_order_relaxed);
+                }
+            }
+            out.emplace_back(r.names[k], t);
+        }
+        return out;
+    }
+
+    inline void report(std::ostream &stream) {
+        char line[256];
+        snprintf(line, sizeof(line), "%-24s %10s %12s %12s %9s %14s %14s %6s %12s\n",
+                 "kernel", "calls", "elements", "total us", "ns/elem", "cycles", "instructions", "IPC", "cache miss");
+        stream << line;
+        for (auto const &[name, t] : summary()) {
+            double const per_element = t.elements ? static_cast<double>(t.nanoseconds) / t.elements : 0.;
+            double const ipc = t.counters[CYCLES] ? static_cast<double>(t.counters[INSTRUCTIONS]) / t.counters[CYCLES] : 0.;
+            snprintf(line, sizeof(line), "%-24s %10llu %12llu %12.1f %9.3f %14llu %14llu %6.2f %12llu\n", name,
+                     static_cast<unsigned long long>(t.calls), static_cast<unsigned long long>(t.elements),
+                     t.nanoseconds * 1e-3, per_element,
+                     static_cast<unsigned long long>(t.counters[CYCLES]),
+                     static_cast<unsigned long long>(t.counters[INSTRUCTIONS]), ipc,
+                     static_cast<unsigned long long>(t.counters[CACHE_MISSES]));
+            stream << line;
+        }
+        auto &r = detail::global();
+        std::lock_guard<std::mutex> guard(r.lock);
+        if (r.next_thread_id && !r.counters_available) {
+            stream << "hardware counters unavailable (perf_event_open failed)\n";
+        }
+    }
+
+    /* Every recorded call as a complete ("X") event in the Chrome trace event format */
+    inline void write_chrome_trace(std::ostream &stream) {
+        auto &r = detail::global();
+        std::lock_guard<std::mutex> guard(r.lock);
+        char line[256];
+        char const *separator = "";
+        auto write = [&](uint64_t thread_id, event const &e) {
+            snprintf(line, sizeof(line),
+                     "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"elements\":%llu}}",
+                     separator, r.names[e.kernel], static_cast<unsigned long long>(thread_id),
+                     e.start_ns * 1e-3, e.duration_ns * 1e-3, static_cast<unsigned long long>(e.elements));
+            stream << line;
+            separator = ",";
+        };
+        stream << "{\"traceEvents\":[";
+        for (auto const &t : r.retired_events) {
+            write(t.thread_id, t.e);
+        }
+        for (auto const &b : r.threads) {
+            std::size_t const n = b->recorded.load(std::memory_order_acquire);
+            event const *events = n ? b->events.load(std::memory_order_acquire) : nullptr;
+            for (std::size_t i = 0; i < n; ++i) {
+                write(b->thread_id, events[i]);
+            }
+        }
+        stream << "\n]}\n";
+    }
+
+}
+}
+
+#endif //MATHEMATICS_PROFILE_HPP
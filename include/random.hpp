@@ -0,0 +1,265 @@
+#ifndef MATHEMATICS_RANDOM_HPP
+#define MATHEMATICS_RANDOM_HPP
+
+#include <immintrin.h>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "float2.hpp"
+#include "float3.hpp"
+#include "float4.hpp"
+#include "float4x4.hpp"
+#include "soa.hpp"
+
+namespace mathsimd {
+
+    namespace detail {
+
+        inline uint64_t splitmix64(uint64_t &x) {
+            uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        /* Scalar xoshiro128** step: advances s and returns its output. rng uses it to
+         * position the streams when seeding, and it is the reference for every lane. */
+        inline uint32_t xoshiro128_next(uint32_t s[4]) {
+            uint32_t const s1x5 = s[1] * 5;
+            uint32_t const result = ((s1x5 << 7) | (s1x5 >> 25)) * 9;
+            uint32_t const t = s[1] << 9;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = (s[3] << 11) | (s[3] >> 21);
+            return result;
+        }
+
+        /* Advances s by 2^64 (jump) or 2^96 (long jump) steps */
+        inline void xoshiro128_jump(uint32_t s[4], uint32_t const (&poly)[4]) {
+            uint32_t acc[4]{0, 0, 0, 0};
+            for (uint32_t word : poly) {
+                for (int b = 0; b < 32; ++b) {
+                    if (word & (1u << b)) {
+                        for (int i = 0; i < 4; ++i) { acc[i] ^= s[i]; }
+                    }
+                    xoshiro128_next(s);
+                }
+            }
+            for (int i = 0; i < 4; ++i) { s[i] = acc[i]; }
+        }
+
+        constexpr uint32_t XOSHIRO128_JUMP[4]{0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b};
+        constexpr uint32_t XOSHIRO128_LONG_JUMP[4]{0xb523952e, 0x0b6f099f, 0xccf5a0ef, 0x1c580662};
+
+        inline __m256i rotl(__m256i x, int k) {
+            return _mm256_or_si256(_mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 32 - k));
+        }
+
+        /* Moves the lanes selected by mask to the front of v */
+        inline __m256 left_pack(__m256 v, int mask) {
+            uint64_t const expanded = _pdep_u64(static_cast<uint64_t>(mask), 0x0101010101010101ull) * 0xff;
+            uint64_t const indices = _pext_u64(0x0706050403020100ull, expanded);
+            return _mm256_permutevar8x32_ps(v, _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<long long>(indices))));
+        }
+
+        /* Maps u in [0, 1) onto [lo, hi). lo + u * (hi - lo) can round up to hi itself,
+         * so the result is clamped to the float just inside hi. */
+        inline __m256 uniform_range(__m256 u, float lo, float hi) {
+            __m256 const r = _mm256_fmadd_ps(u, _mm256_set1_ps(hi - lo), _mm256_set1_ps(lo));
+            __m256 const inside = _mm256_set1_ps(std::nextafter(hi, lo));
+            return hi > lo ? _mm256_min_ps(r, inside) : _mm256_max_ps(r, inside);
+        }
+
+        /* Calls generate(out) once per 8 outputs, staging the tail through a scratch
+         * buffer so the full batches can write straight to dst */
+        template<typename T, typename F>
+        inline void fill_batches(T *dst, std::size_t count, F &&generate) {
+            std::size_t n = 0;
+            for (; n + LANES <= count; n += LANES) {
+                generate(&dst[n].x());
+            }
+            if (n < count) {
+                T tmp[LANES];
+                generate(&tmp[0].x());
+                copy_vectors(tmp, dst + n, count - n);
+            }
+        }
+    }
+
+    /* Eight interleaved xoshiro128** generators, one per lane. Lanes are 2^64 steps
+     * apart and streams 2^96 apart, so no two lanes of any streams ever overlap. */
+    struct rng {
+    private:
+        __m256i _s[4];
+        static inline std::atomic<uint64_t> _next_stream{0};
+    public:
+        explicit rng(uint64_t seed = 1234, uint64_t stream = 0) {
+            uint32_t s[4];
+            for (int i = 0; i < 4; i += 2) {
+                uint64_t const v = detail::splitmix64(seed);
+                s[i] = static_cast<uint32_t>(v);
+                s[i + 1] = static_cast<uint32_t>(v >> 32);
+            }
+            for (uint64_t i = 0; i < stream; ++i) {
+                detail::xoshiro128_jump(s, detail::XOSHIRO128_LONG_JUMP);
+            }
+            alignas(32) uint32_t lanes[4][8];
+            for (int l = 0; l < 8; ++l) {
+                for (int i = 0; i < 4; ++i) { lanes[i][l] = s[i]; }
+                detail::xoshiro128_jump(s, detail::XOSHIRO128_JUMP);
+            }
+            for (int i = 0; i < 4; ++i) {
+                _s[i] = _mm256_load_si256(reinterpret_cast<__m256i const *>(lanes[i]));
+            }
+        }
+
+        /* A generator private to the calling thread, on its own stream */
+        static rng &local() {
+            thread_local rng instance(1234, _next_stream.fetch_add(1, std::memory_order_relaxed));
+            return instance;
+        }
+
+        /* 8 uniformly distributed 32 bit integers */
+        inline __m256i next() {
+            __m256i const s1x5 = _mm256_add_epi32(_mm256_slli_epi32(_s[1], 2), _s[1]);
+            __m256i const r = detail::rotl(s1x5, 7);
+            __m256i const result = _mm256_add_epi32(_mm256_slli_epi32(r, 3), r);
+            __m256i const t = _mm256_slli_epi32(_s[1], 9);
+            _s[2] = _mm256_xor_si256(_s[2], _s[0]);
+            _s[3] = _mm256_xor_si256(_s[3], _s[1]);
+            _s[1] = _mm256_xor_si256(_s[1], _s[2]);
+            _s[0] = _mm256_xor_si256(_s[0], _s[3]);
+            _s[2] = _mm256_xor_si256(_s[2], t);
+            _s[3] = detail::rotl(_s[3], 11);
+            return result;
+        }
+
+        /* 8 uniform floats in [0, 1), built from the top 24 bits */
+        inline __m256 uniform() {
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(next(), 8)), _mm256_set1_ps(1.f / 16777216.f));
+        }
+
+        /* 8 uniform floats in [lo, hi) */
+        inline __m256 uniform(float lo, float hi) {
+            return detail::uniform_range(uniform(), lo, hi);
+        }
+
+        /* D dimensional points uniformly inside the unit ball, by rejection from the
+         * enclosing cube; accepted candidates are packed until 8 are ready */
+        template<int D>
+        inline void ball(__m256 out[D]) {
+            alignas(32) float buf[D][16];
+            int ready = 0;
+            while (ready < 8) {
+                __m256 p[D];
+                __m256 r2 = _mm256_setzero_ps();
+                for (int d = 0; d < D; ++d) {
+                    p[d] = uniform(-1.f, 1.f);
+                    r2 = _mm256_fmadd_ps(p[d], p[d], r2);
+                }
+                // also reject the origin so that callers can normalise safely
+                __m256 const inside = _mm256_and_ps(_mm256_cmp_ps(r2, _mm256_set1_ps(1.f), _CMP_LT_OQ),
+                                                    _mm256_cmp_ps(r2, _mm256_set1_ps(1e-12f), _CMP_GT_OQ));
+                int const mask = _mm256_movemask_ps(inside);
+                for (int d = 0; d < D; ++d) {
+                    _mm256_storeu_ps(buf[d] + ready, detail::left_pack(p[d], mask));
+                }
+                ready += _mm_popcnt_u32(static_cast<unsigned>(mask));
+            }
+            for (int d = 0; d < D; ++d) { out[d] = _mm256_load_ps(buf[d]); }
+        }
+
+        template<int D>
+        inline void sphere(__m256 out[D]) {
+            ball<D>(out);
+            __m256 r2 = _mm256_setzero_ps();
+            for (int d = 0; d < D; ++d) { r2 = _mm256_fmadd_ps(out[d], out[d], r2); }
+            __m256 const inv = _mm256_div_ps(_mm256_set1_ps(1.f), _mm256_sqrt_ps(r2));
+            for (int d = 0; d < D; ++d) { out[d] = _mm256_mul_ps(out[d], inv); }
+        }
+    };
+
+    inline void fill_uniform(rng &g, float *dst, std::size_t count, float lo = 0.f, float hi = 1.f) {
+        std::size_t n = 0;
+        for (; n + detail::LANES <= count; n += detail::LANES) {
+            _mm256_storeu_ps(dst + n, g.uniform(lo, hi));
+        }
+        if (n < count) {
+            alignas(32) float tmp[detail::LANES];
+            _mm256_store_ps(tmp, g.uniform(lo, hi));
+            for (std::size_t l = 0; n + l < count; ++l) { dst[n + l] = tmp[l]; }
+        }
+    }
+
+    inline void fill_box(rng &g, float2 *dst, std::size_t count, float2 const &lo, float2 const &hi) {
+        detail::fill_batches<float2>(dst, count, [&](float *out) {
+            detail::store_xy(g.uniform(lo.x(), hi.x()), g.uniform(lo.y(), hi.y()), out);
+        });
+    }
+
+    inline void fill_box(rng &g, float3 *dst, std::size_t count, float3 const &lo, float3 const &hi) {
+        detail::fill_batches<float3>(dst, count, [&](float *out) {
+            detail::store_xyzw(g.uniform(lo.x(), hi.x()), g.uniform(lo.y(), hi.y()), g.uniform(lo.z(), hi.z()),
+                               _mm256_setzero_ps(), out);
+        });
+    }
+
+    inline void fill_box(rng &g, float4 *dst, std::size_t count, float4 const &lo, float4 const &hi) {
+        detail::fill_batches<float4>(dst, count, [&](float *out) {
+            detail::store_xyzw(g.uniform(lo.x(), hi.x()), g.uniform(lo.y(), hi.y()), g.uniform(lo.z(), hi.z()),
+                               g.uniform(lo.w(), hi.w()), out);
+        });
+    }
+
+    inline void fill_unit_sphere(rng &g, float3 *dst, std::size_t count) {
+        detail::fill_batches<float3>(dst, count, [&](float *out) {
+            __m256 p[3];
+            g.sphere<3>(p);
+            detail::store_xyzw(p[0], p[1], p[2], _mm256_setzero_ps(), out);
+        });
+    }
+
+    inline void fill_unit_ball(rng &g, float3 *dst, std::size_t count) {
+        detail::fill_batches<float3>(dst, count, [&](float *out) {
+            __m256 p[3];
+            g.ball<3>(p);
+            detail::store_xyzw(p[0], p[1], p[2], _mm256_setzero_ps(), out);
+        });
+    }
+
+    /* Uniformly distributed unit quaternions stored as (x, y, z, w) */
+    inline void fill_rotation(rng &g, float4 *dst, std::size_t count) {
+        detail::fill_batches<float4>(dst, count, [&](float *out) {
+            __m256 q[4];
+            g.sphere<4>(q);
+            detail::store_xyzw(q[0], q[1], q[2], q[3], out);
+        });
+    }
+
+    inline void fill_rotation(rng &g, float4x4 *dst, std::size_t count) {
+        using namespace detail;
+        __m256 const zero = _mm256_setzero_ps();
+        __m256 const one = _mm256_set1_ps(1.f);
+        for_each_batch(count, [&](std::size_t first, std::size_t lanes) {
+            __m256 q[4];
+            g.sphere<4>(q);
+            __m256 const x2 = _mm256_add_ps(q[0], q[0]), y2 = _mm256_add_ps(q[1], q[1]), z2 = _mm256_add_ps(q[2], q[2]);
+            __m256 const xx = _mm256_mul_ps(q[0], x2), yy = _mm256_mul_ps(q[1], y2), zz = _mm256_mul_ps(q[2], z2);
+            __m256 const xy = _mm256_mul_ps(q[0], y2), xz = _mm256_mul_ps(q[0], z2), yz = _mm256_mul_ps(q[1], z2);
+            __m256 const wx = _mm256_mul_ps(q[3], x2), wy = _mm256_mul_ps(q[3], y2), wz = _mm256_mul_ps(q[3], z2);
+            __m256 const m[16]{
+                _mm256_sub_ps(one, _mm256_add_ps(yy, zz)), _mm256_add_ps(xy, wz), _mm256_sub_ps(xz, wy), zero,
+                _mm256_sub_ps(xy, wz), _mm256_sub_ps(one, _mm256_add_ps(xx, zz)), _mm256_add_ps(yz, wx), zero,
+                _mm256_add_ps(xz, wy), _mm256_sub_ps(yz, wx), _mm256_sub_ps(one, _mm256_add_ps(xx, yy)), zero,
+                zero, zero, zero, one};
+            store_soa<16>(m, lanes, dst[first], stride_of<float4x4>());
+        });
+    }
+
+}
+
+#endif //MATHEMATICS_RANDOM_HPP
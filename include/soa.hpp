@@ -0,0 +1,154 @@
+#ifndef MATHEMATICS_SOA_HPP
+#define MATHEMATICS_SOA_HPP
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstddef>
+
+namespace mathsimd {
+
+    /* Helpers shared by the batched kernels, which work on 8 objects at a time with
+     * element e of every object held in one __m256 (lane l = object l). */
+    namespace detail {
+
+        constexpr std::size_t LANES = 8;
+
+        template<typename T>
+        constexpr std::size_t stride_of() { return sizeof(T) / sizeof(float); }
+
+        template<typename F>
+        inline void for_each_batch(std::size_t count, F &&kernel) {
+            for (std::size_t first = 0; first < count; first += LANES) {
+                kernel(first, std::min(LANES, count - first));
+            }
+        }
+
+        /* Transposes `lanes` objects of E floats, `stride` floats apart, into SoA
+         * registers. Missing lanes are filled from pad so they stay well conditioned. */
+        template<int E>
+        inline void load_soa(float const *src, std::size_t stride, std::size_t lanes, __m256 out[E], float const pad[E]) {
+            alignas(32) float tmp[E][LANES];
+            for (int e = 0; e < E; ++e) {
+                for (std::size_t l = 0; l < LANES; ++l) {
+                    tmp[e][l] = l < lanes ? src[l * stride + e] : pad[e];
+                }
+                out[e] = _mm256_load_ps(tmp[e]);
+            }
+        }
+
+        template<int E>
+        inline void store_soa(__m256 const in[E], std::size_t lanes, float *dst, std::size_t stride) {
+            alignas(32) float tmp[E][LANES];
+            for (int e = 0; e < E; ++e) {
+                _mm256_store_ps(tmp[e], in[e]);
+            }
+            for (std::size_t l = 0; l < lanes; ++l) {
+                for (int e = 0; e < E; ++e) {
+                    dst[l * stride + e] = tmp[e][l];
+                }
+            }
+        }
+
+        /* Writes 8 float4 (or 16-byte float3) held as SoA registers to dst as AoS */
+        inline void store_xyzw(__m256 x, __m256 y, __m256 z, __m256 w, float *dst) {
+            __m256 const xy0 = _mm256_unpacklo_ps(x, y), xy1 = _mm256_unpackhi_ps(x, y);
+            __m256 const zw0 = _mm256_unpacklo_ps(z, w), zw1 = _mm256_unpackhi_ps(z, w);
+            __m256 const v0 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1,0,1,0));
+            __m256 const v1 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3,2,3,2));
+            __m256 const v2 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1,0,1,0));
+            __m256 const v3 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3,2,3,2));
+            _mm256_storeu_ps(dst, _mm256_permute2f128_ps(v0, v1, 0x20));
+            _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(v2, v3, 0x20));
+            _mm256_storeu_ps(dst + 16, _mm256_permute2f128_ps(v0, v1, 0x31));
+            _mm256_storeu_ps(dst + 24, _mm256_permute2f128_ps(v2, v3, 0x31));
+        }
+
+        inline void store_xy(__m256 x, __m256 y, float *dst) {
+            __m256 const lo = _mm256_unpacklo_ps(x, y), hi = _mm256_unpackhi_ps(x, y);
+            _mm256_storeu_ps(dst, _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+
+        /* Reads 8 float4 (or 16-byte float3) from src into SoA registers */
+        inline void load_xyzw(float const *src, __m256 &x, __m256 &y, __m256 &z, __m256 &w) {
+            __m256 const v0 = _mm256_loadu2_m128(src + 16, src);
+            __m256 const v1 = _mm256_loadu2_m128(src + 20, src + 4);
+            __m256 const v2 = _mm256_loadu2_m128(src + 24, src + 8);
+            __m256 const v3 = _mm256_loadu2_m128(src + 28, src + 12);
+            __m256 const xy0 = _mm256_unpacklo_ps(v0, v1), zw0 = _mm256_unpackhi_ps(v0, v1);
+            __m256 const xy1 = _mm256_unpacklo_ps(v2, v3), zw1 = _mm256_unpackhi_ps(v2, v3);
+            x = _mm256_shuffle_ps(xy0, xy1, _MM_SHUFFLE(1,0,1,0));
+            y = _mm256_shuffle_ps(xy0, xy1, _MM_SHUFFLE(3,2,3,2));
+            z = _mm256_shuffle_ps(zw0, zw1, _MM_SHUFFLE(1,0,1,0));
+            w = _mm256_shuffle_ps(zw0, zw1, _MM_SHUFFLE(3,2,3,2));
+        }
+
+        /* In-place transpose of an 8 x 8 block of floats held one row per register */
+        inline void transpose8x8(__m256 r[8]) {
+            __m256 t[8], u[8];
+            for (int i = 0; i < 8; i += 2) {
+                t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+                t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+            }
+            for (int i = 0; i < 8; i += 4) {
+                u[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1,0,1,0));
+                u[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3,2,3,2));
+                u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1,0,1,0));
+                u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3,2,3,2));
+            }
+            for (int i = 0; i < 4; ++i) {
+                r[i] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+                r[i + 4] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+            }
+        }
+
+#ifdef __AVX512F__
+        /* In-place transpose of a 16 x 16 block of floats held one row per register */
+        inline void transpose16x16(__m512 r[16]) {
+            __m512 t[16], u[16];
+            for (int i = 0; i < 16; i += 2) {
+                t[i] = _mm512_unpacklo_ps(r[i], r[i + 1]);
+                t[i + 1] = _mm512_unpackhi_ps(r[i], r[i + 1]);
+            }
+            for (int i = 0; i < 16; i += 4) {
+                u[i] = _mm512_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1,0,1,0));
+                u[i + 1] = _mm512_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3,2,3,2));
+                u[i + 2] = _mm512_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1,0,1,0));
+                u[i + 3] = _mm512_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3,2,3,2));
+            }
+            // then swap 128 bit lanes between rows 4 and 8 apart
+            for (int j = 0; j < 4; ++j) {
+                t[j] = _mm512_shuffle_f32x4(u[j], u[4 + j], 0x88);
+                t[4 + j] = _mm512_shuffle_f32x4(u[j], u[4 + j], 0xdd);
+                t[8 + j] = _mm512_shuffle_f32x4(u[8 + j], u[12 + j], 0x88);
+                t[12 + j] = _mm512_shuffle_f32x4(u[8 + j], u[12 + j], 0xdd);
+            }
+            for (int j = 0; j < 4; ++j) {
+                r[j] = _mm512_shuffle_f32x4(t[j], t[8 + j], 0x88);
+                r[8 + j] = _mm512_shuffle_f32x4(t[j], t[8 + j], 0xdd);
+                r[4 + j] = _mm512_shuffle_f32x4(t[4 + j], t[12 + j], 0x88);
+                r[12 + j] = _mm512_shuffle_f32x4(t[4 + j], t[12 + j], 0xdd);
+            }
+        }
+#endif
+
+        /* dst[i] = src[i] for float2/float3/float4, assigned through __m128 so that the
+         * padding lane of float3 is copied too; its defaulted assignment copies xyz only */
+        template<typename T>
+        inline void copy_vectors(T const *src, T *dst, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) { dst[i] = static_cast<__m128>(src[i]); }
+        }
+
+        /* Column-major R x C identity, used to pad partial batches of matrices */
+        template<int R, int C = R>
+        struct identity_pad {
+            float val[R * C]{};
+            constexpr identity_pad() {
+                for (int i = 0; i < R && i < C; ++i) { val[i * (R + 1)] = 1.f; }
+            }
+        };
+    }
+
+}
+
+#endif //MATHEMATICS_SOA_HPP
@@ -0,0 +1,256 @@
+#ifndef MATHEMATICS_SOLVE_HPP
+#define MATHEMATICS_SOLVE_HPP
+
+#include <immintrin.h>
+#include <cstddef>
+#include "float3.hpp"
+#include "float4.hpp"
+#include "float3x3.hpp"
+#include "float4x4.hpp"
+#include "bool.hpp"
+#include "soa.hpp"
+
+namespace mathsimd {
+
+    /* Batched small linear solvers. Each kernel solves 8 independent systems held in
+     * SoA registers (a[e] is column-major element e of every matrix) and returns the
+     * lanes whose system was singular to working precision; x is zero in those lanes. */
+    namespace detail {
+
+        inline __m256 abs(__m256 v) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), v); }
+
+        /* Pivots smaller than this, relative to the largest entry of the matrix, count as zero */
+        template<int E>
+        inline __m256 singular_threshold(__m256 const a[E]) {
+            __m256 scale = abs(a[0]);
+            for (int e = 1; e < E; ++e) {
+                scale = _mm256_max_ps(scale, abs(a[e]));
+            }
+            return _mm256_mul_ps(scale, _mm256_set1_ps(EPSILON_F));
+        }
+
+        /* Solves the upper triangular system u x = y; u[r][c] is row-major */
+        template<int N, int S>
+        inline void back_substitute(__m256 const u[][S], __m256 const y[N], __m256 x[N]) {
+            for (int k = N - 1; k >= 0; --k) {
+                __m256 sum = y[k];
+                for (int c = k + 1; c < N; ++c) {
+                    sum = _mm256_fnmadd_ps(u[k][c], x[c], sum);
+                }
+                x[k] = _mm256_div_ps(sum, u[k][k]);
+            }
+        }
+
+        template<int N>
+        inline Bool<8> finish(__m256 singular, __m256 x[N]) {
+            for (int k = 0; k < N; ++k) {
+                x[k] = _mm256_andnot_ps(singular, x[k]);
+            }
+            return {_mm256_movemask_ps(singular)};
+        }
+
+        template<int N, typename Matrix, typename Vector, typename Kernel>
+        inline void solve_batches(Matrix const *a, Vector const *b, Vector *x, bool *singular, std::size_t count, Kernel &&kernel) {
+            constexpr identity_pad<N> pad;
+            constexpr float zero[N]{};
+            for_each_batch(count, [&](std::size_t first, std::size_t lanes) {
+                __m256 ma[N * N], mb[N], mx[N];
+                load_soa<N * N>(a[first], stride_of<Matrix>(), lanes, ma, pad.val);
+                load_soa<N>(b[first], stride_of<Vector>(), lanes, mb, zero);
+                Bool<8> mask = kernel(ma, mb, mx);
+                store_soa<N>(mx, lanes, &x[first].x(), stride_of<Vector>());
+                for (std::size_t l = 0; singular && l < lanes; ++l) {
+                    singular[first + l] = mask[l];
+                }
+            });
+        }
+    }
+
+    /* Gaussian elimination with partial pivoting on 8 N x N systems a x = b */
+    template<int N>
+    inline Bool<8> solve8(__m256 const a[N * N], __m256 const b[N], __m256 x[N]) {
+        using namespace detail;
+        __m256 const one = _mm256_set1_ps(1.f);
+        __m256 const threshold = singular_threshold<N * N>(a);
+        __m256 singular = _mm256_setzero_ps();
+
+        // row-major augmented matrix [a | b] so that row swaps stay within one index
+        __m256 m[N][N + 1];
+        for (int r = 0; r < N; ++r) {
+            for (int c = 0; c < N; ++c) {
+                m[r][c] = a[c * N + r];
+            }
+            m[r][N] = b[r];
+        }
+
+        __m256 y[N];
+        for (int k = 0; k < N; ++k) {
+            // each lane pivots independently: bubble the largest candidate into row k
+            for (int i = k + 1; i < N; ++i) {
+                __m256 const swap = _mm256_cmp_ps(abs(m[i][k]), abs(m[k][k]), _CMP_GT_OQ);
+                for (int c = k; c <= N; ++c) {
+                    __m256 const t = m[k][c];
+                    m[k][c] = _mm256_blendv_ps(t, m[i][c], swap);
+                    m[i][c] = _mm256_blendv_ps(m[i][c], t, swap);
+                }
+            }
+            __m256 const bad = _mm256_cmp_ps(abs(m[k][k]), threshold, _CMP_LE_OQ);
+            singular = _mm256_or_ps(singular, bad);
+            m[k][k] = _mm256_blendv_ps(m[k][k], one, bad);
+            __m256 const inv = _mm256_div_ps(one, m[k][k]);
+            for (int i = k + 1; i < N; ++i) {
+                __m256 const f = _mm256_mul_ps(m[i][k], inv);
+                for (int c = k + 1; c <= N; ++c) {
+                    m[i][c] = _mm256_fnmadd_ps(f, m[k][c], m[i][c]);
+                }
+            }
+            y[k] = m[k][N];
+        }
+
+        back_substitute<N>(m, y, x);
+        return finish<N>(singular, x);
+    }
+
+    /* Cholesky factorisation a = l l^T of 8 symmetric positive definite N x N systems.
+     * Only the lower triangle of a is read; lanes that are not positive definite are flagged. */
+    template<int N>
+    inline Bool<8> solve_spd8(__m256 const a[N * N], __m256 const b[N], __m256 x[N]) {
+        using namespace detail;
+        __m256 const one = _mm256_set1_ps(1.f);
+        __m256 const threshold = singular_threshold<N * N>(a);
+        __m256 singular = _mm256_setzero_ps();
+
+        // lt[r][c] = l(c, r), the upper triangular transpose used for back substitution
+        __m256 lt[N][N];
+        for (int j = 0; j < N; ++j) {
+            __m256 d = a[j * N + j];
+            for (int k = 0; k < j; ++k) {
+                d = _mm256_fnmadd_ps(lt[k][j], lt[k][j], d);
+            }
+            __m256 const bad = _mm256_cmp_ps(d, threshold, _CMP_LE_OQ);
+            singular = _mm256_or_ps(singular, bad);
+            lt[j][j] = _mm256_sqrt_ps(_mm256_blendv_ps(d, one, bad));
+            __m256 const inv = _mm256_div_ps(one, lt[j][j]);
+            for (int i = j + 1; i < N; ++i) {
+                __m256 s = a[j * N + i];
+                for (int k = 0; k < j; ++k) {
+                    s = _mm256_fnmadd_ps(lt[k][i], lt[k][j], s);
+                }
+                lt[j][i] = _mm256_mul_ps(s, inv);
+            }
+        }
+
+        __m256 y[N];
+        for (int i = 0; i < N; ++i) {
+            __m256 s = b[i];
+            for (int k = 0; k < i; ++k) {
+                s = _mm256_fnmadd_ps(lt[k][i], y[k], s);
+            }
+            y[i] = _mm256_div_ps(s, lt[i][i]);
+        }
+
+        back_substitute<N>(lt, y, x);
+        return finish<N>(singular, x);
+    }
+
+    /* Least-squares solution of 8 overdetermined M x N systems, minimising |a x - b|,
+     * by Householder QR. Rank deficient lanes are flagged. */
+    template<int M, int N>
+    inline Bool<8> least_squares8(__m256 const a[M * N], __m256 const b[M], __m256 x[N]) {
+        static_assert(M >= N, "least squares needs at least as many equations as unknowns");
+        using namespace detail;
+        __m256 const zero = _mm256_setzero_ps();
+        __m256 const sign_bit = _mm256_set1_ps(-0.f);
+        __m256 const threshold = singular_threshold<M * N>(a);
+        __m256 singular = zero;
+
+        __m256 q[N][M];
+        __m256 y[M];
+        for (int c = 0; c < N; ++c) {
+            for (int r = 0; r < M; ++r) {
+                q[c][r] = a[c * M + r];
+            }
+        }
+        for (int r = 0; r < M; ++r) {
+            y[r] = b[r];
+        }
+
+        // r_upper[r][c] holds R row-major for the back substitution
+        __m256 r_upper[N][N];
+        for (int k = 0; k < N; ++k) {
+            __m256 norm2 = zero;
+            for (int r = k; r < M; ++r) {
+                norm2 = _mm256_fmadd_ps(q[k][r], q[k][r], norm2);
+            }
+            __m256 const norm = _mm256_sqrt_ps(norm2);
+            __m256 const bad = _mm256_cmp_ps(norm, threshold, _CMP_LE_OQ);
+            singular = _mm256_or_ps(singular, bad);
+
+            // reflect column k onto alpha * e_k with v = q_k - alpha * e_k and H = I - tau * v v^T
+            __m256 const alpha = _mm256_xor_ps(norm, _mm256_andnot_ps(q[k][k], sign_bit));
+            __m256 const vk = _mm256_sub_ps(q[k][k], alpha);
+            __m256 const tau = _mm256_andnot_ps(bad, _mm256_div_ps(_mm256_set1_ps(-1.f), _mm256_mul_ps(alpha, vk)));
+            q[k][k] = vk;
+            for (int c = k + 1; c < N; ++c) {
+                __m256 d = zero;
+                for (int r = k; r < M; ++r) {
+                    d = _mm256_fmadd_ps(q[k][r], q[c][r], d);
+                }
+                d = _mm256_mul_ps(d, tau);
+                for (int r = k; r < M; ++r) {
+                    q[c][r] = _mm256_fnmadd_ps(d, q[k][r], q[c][r]);
+                }
+                r_upper[k][c] = q[c][k];
+            }
+            __m256 d = zero;
+            for (int r = k; r < M; ++r) {
+                d = _mm256_fmadd_ps(q[k][r], y[r], d);
+            }
+            d = _mm256_mul_ps(d, tau);
+            for (int r = k; r < M; ++r) {
+                y[r] = _mm256_fnmadd_ps(d, q[k][r], y[r]);
+            }
+            r_upper[k][k] = _mm256_blendv_ps(alpha, _mm256_set1_ps(1.f), bad);
+        }
+
+        back_substitute<N>(r_upper, y, x);
+        return finish<N>(singular, x);
+    }
+
+    inline void solve(float4x4 const *a, float4 const *b, float4 *x, bool *singular, std::size_t count) {
+        detail::solve_batches<4>(a, b, x, singular, count, solve8<4>);
+    }
+
+    inline void solve(float3x3 const *a, float3 const *b, float3 *x, bool *singular, std::size_t count) {
+        detail::solve_batches<3>(a, b, x, singular, count, solve8<3>);
+    }
+
+    inline void solve_spd(float4x4 const *a, float4 const *b, float4 *x, bool *singular, std::size_t count) {
+        detail::solve_batches<4>(a, b, x, singular, count, solve_spd8<4>);
+    }
+
+    inline void solve_spd(float3x3 const *a, float3 const *b, float3 *x, bool *singular, std::size_t count) {
+        detail::solve_batches<3>(a, b, x, singular, count, solve_spd8<3>);
+    }
+
+    /* a holds count column-major M x N matrices back to back, b count M-vectors and x count N-vectors */
+    template<int M, int N>
+    inline void least_squares(float const *a, float const *b, float *x, bool *singular, std::size_t count) {
+        using namespace detail;
+        constexpr identity_pad<M, N> pad;
+        constexpr float zero[M]{};
+        for_each_batch(count, [&](std::size_t first, std::size_t lanes) {
+            __m256 ma[M * N], mb[M], mx[N];
+            load_soa<M * N>(a + first * M * N, M * N, lanes, ma, pad.val);
+            load_soa<M>(b + first * M, M, lanes, mb, zero);
+            Bool<8> mask = least_squares8<M, N>(ma, mb, mx);
+            store_soa<N>(mx, lanes, x + first * N, N);
+            for (std::size_t l = 0; singular && l < lanes; ++l) {
+                singular[first + l] = mask[l];
+            }
+        });
+    }
+
+}
+
+#endif //MATHEMATICS_SOLVE_HPP
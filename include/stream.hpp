@@ -0,0 +1,403 @@
+#ifndef MATHEMATICS_STREAM_HPP
+#define MATHEMATICS_STREAM_HPP
+
+#include <immintrin.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "batch.hpp"
+#include "float3.hpp"
+#include "float4.hpp"
+#include "float4x4.hpp"
+#include "soa.hpp"
+
+namespace mathsimd {
+
+    /* Out-of-core processing of float3/float4 arrays. A reader thread fills chunks from a
+     * file descriptor, the calling thread runs the kernel chain on them and a writer thread
+     * writes them out, so reading chunk n + 1, computing chunk n and writing chunk n - 1
+     * overlap. Only a fixed pool of chunks circulates between the three, which bounds memory. */
+
+    /* On-disk layout of a record. PACKED holds only the components: 12 bytes of xyz for a
+     * float3, 16 for a float4. RAW is the 16-byte in-memory object, padding included. */
+    enum stream_record { PACKED, RAW };
+
+    struct stream_stage_stats {
+        char const *name{""};
+        uint64_t elements{0};
+        uint64_t bytes{0};
+        /* time spent working, and time spent blocked waiting for a chunk */
+        uint64_t busy_ns{0};
+        uint64_t wait_ns{0};
+
+        /* elements per second of busy time */
+        double throughput() const { return busy_ns ? elements * 1e9 / busy_ns : 0.; }
+    };
+
+    struct stream_stats {
+        stream_stage_stats read{"read"};
+        stream_stage_stats compute{"compute"};
+        stream_stage_stats write{"write"};
+        /* one entry per kernel, in pipeline order; elements counts what entered the kernel */
+        std::vector<stream_stage_stats> kernels;
+        uint64_t wall_ns{0};
+        /* errno of the first failed read or write, 0 on success. EINVAL if the input ends
+         * in a partial record; the whole records before it are still processed and written. */
+        int error{0};
+
+        void report(std::ostream &stream) const {
+            char line[256];
+            snprintf(line, sizeof(line), "%-20s %12s %12s %10s %10s %10s\n",
+                     "stage", "elements", "MB", "busy ms", "wait ms", "Melem/s");
+            stream << line;
+            auto row = [&](stream_stage_stats const &s, char const *indent) {
+                snprintf(line, sizeof(line), "%s%-*s %12llu %12.2f %10.2f %10.2f %10.2f\n", indent,
+                         20 - static_cast<int>(std::char_traits<char>::length(indent)), s.name,
+                         static_cast<unsigned long long>(s.elements), s.bytes * 1e-6,
+                         s.busy_ns * 1e-6, s.wait_ns * 1e-6, s.throughput() * 1e-6);
+                stream << line;
+            };
+            row(read, "");
+            row(compute, "");
+            for (auto const &k : kernels) { row(k, "  "); }
+            row(write, "");
+            snprintf(line, sizeof(line), "wall %.2f ms, %.2f Melem/s\n", wall_ns * 1e-6,
+                     wall_ns ? read.elements * 1e3 / wall_ns : 0.);
+            stream << line;
+        }
+    };
+
+    namespace detail {
+
+        inline uint64_t elapsed_ns(std::chrono::steady_clock::time_point since) {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - since).count());
+        }
+
+        /* FIFO of chunks handed from one stage to the next. Pops block until a chunk
+         * arrives, and return nullptr once the queue is closed and drained. */
+        template<typename C>
+        struct chunk_queue {
+        private:
+            std::mutex _lock;
+            std::condition_variable _ready;
+            std::deque<C *> _items;
+            bool _closed{false};
+        public:
+            void push(C *c) {
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    _items.push_back(c);
+                }
+                _ready.notify_one();
+            }
+            void close() {
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    _closed = true;
+                }
+                _ready.notify_all();
+            }
+            C *pop(uint64_t &wait_ns) {
+                auto const start = std::chrono::steady_clock::now();
+                std::unique_lock<std::mutex> guard(_lock);
+                _ready.wait(guard, [this] { return _closed || !_items.empty(); });
+                wait_ns += elapsed_ns(start);
+                if (_items.empty()) { return nullptr; }
+                C *c = _items.front();
+                _items.pop_front();
+                return c;
+            }
+        };
+
+        /* Reads until bytes have arrived or the input ends, so that pipes delivering short
+         * reads still fill whole chunks. Returns the bytes read, or -1 with errno set. */
+        inline ssize_t read_full(int fd, void *dst, std::size_t bytes) {
+            std::size_t done = 0;
+            while (done < bytes) {
+                ssize_t const r = ::read(fd, static_cast<char *>(dst) + done, bytes - done);
+                if (r == 0) { break; }
+                if (r < 0) {
+                    if (errno == EINTR) { continue; }
+                    return -1;
+                }
+                done += static_cast<std::size_t>(r);
+            }
+            return static_cast<ssize_t>(done);
+        }
+
+        inline bool write_full(int fd, void const *src, std::size_t bytes) {
+            std::size_t done = 0;
+            while (done < bytes) {
+                ssize_t const w = ::write(fd, static_cast<char const *>(src) + done, bytes - done);
+                if (w < 0) {
+                    if (errno == EINTR) { continue; }
+                    return false;
+                }
+                done += static_cast<std::size_t>(w);
+            }
+            return true;
+        }
+
+        /* Unpacks count xyz triples into float3 with a zero padding lane, four at a time */
+        inline void widen_xyz(float const *src, float3 *dst, std::size_t count) {
+            __m128 const zero = _mm_setzero_ps();
+            std::size_t n = 0;
+            for (; n + 4 <= count; n += 4, src += 12) {
+                __m128i const a = _mm_castps_si128(_mm_loadu_ps(src));
+                __m128i const b = _mm_castps_si128(_mm_loadu_ps(src + 4));
+                __m128i const c = _mm_castps_si128(_mm_loadu_ps(src + 8));
+                _mm_store_ps(&dst[n].x(), _mm_blend_ps(_mm_castsi128_ps(a), zero, 8));
+                _mm_store_ps(&dst[n + 1].x(), _mm_blend_ps(_mm_castsi128_ps(_mm_alignr_epi8(b, a, 12)), zero, 8));
+                _mm_store_ps(&dst[n + 2].x(), _mm_blend_ps(_mm_castsi128_ps(_mm_alignr_epi8(c, b, 8)), zero, 8));
+                _mm_store_ps(&dst[n + 3].x(), _mm_castsi128_ps(_mm_srli_si128(c, 4)));
+            }
+            for (; n < count; ++n, src += 3) {
+                _mm_store_ps(&dst[n].x(), _mm_setr_ps(src[0], src[1], src[2], 0.f));
+            }
+        }
+
+        /* The inverse of widen_xyz: writes the xyz of count float3 as packed triples */
+        inline void pack_xyz(float3 const *src, float *dst, std::size_t count) {
+            std::size_t n = 0;
+            for (; n + 4 <= count; n += 4, dst += 12) {
+                __m128i const r0 = _mm_castps_si128(static_cast<__m128>(src[n]));
+                __m128i const r1 = _mm_castps_si128(static_cast<__m128>(src[n + 1]));
+                __m128i const r2 = _mm_castps_si128(static_cast<__m128>(src[n + 2]));
+                __m128i const r3 = _mm_castps_si128(static_cast<__m128>(src[n + 3]));
+                _mm_storeu_ps(dst, _mm_castsi128_ps(_mm_blend_epi32(r0, _mm_slli_si128(r1, 12), 8)));
+                _mm_storeu_ps(dst + 4, _mm_castsi128_ps(_mm_blend_epi32(_mm_srli_si128(r1, 4), _mm_slli_si128(r2, 8), 12)));
+                _mm_storeu_ps(dst + 8, _mm_castsi128_ps(_mm_blend_epi32(_mm_srli_si128(r2, 8), _mm_slli_si128(r3, 4), 14)));
+            }
+            for (; n < count; ++n, dst += 3) {
+                dst[0] = src[n].x();
+                dst[1] = src[n].y();
+                dst[2] = src[n].z();
+            }
+        }
+    }
+
+    /* A chain of kernels applied to a stream of T (float3 or float4). Records are native
+     * byte order floats, PACKED by default: float3 files hold 12-byte xyz records, which
+     * are widened to 16 bytes in the chunk buffer and packed again on output. RAW reads
+     * and writes whole 16-byte objects, ignoring the padding float of a float3 on input.
+     * Kernels may shrink a chunk (cull) but never grow it.
+     *
+     *   stream_pipeline<float3>(1 << 16).transform(m).cull(lo, hi).normalize().run(in, out);
+     */
+    template<typename T>
+    struct stream_pipeline {
+        static_assert(std::is_same_v<T, float3> || std::is_same_v<T, float4>, "stream_pipeline works on float3 or float4");
+        static_assert(sizeof(T) == 16, "T is 16 bytes in memory");
+
+        /* Runs in place over count elements and returns how many remain */
+        using kernel = std::function<std::size_t(T *, std::size_t)>;
+
+    private:
+        struct chunk {
+            std::vector<T> data;
+            /* the file side of a chunk when records are not stored as T */
+            std::vector<float> packed;
+            std::size_t count{0};
+        };
+
+        std::size_t _chunk;
+        std::size_t _buffers;
+        std::size_t _record_bytes;
+        std::vector<std::pair<char const *, kernel>> _kernels;
+
+    public:
+        /* chunk elements are rounded up to a whole number of SIMD batches; memory use is
+         * buffers * chunk * 16 bytes, plus 12 per element for packed float3 records. Three
+         * buffers let read, compute and write all overlap. */
+        explicit stream_pipeline(std::size_t chunk = 1 << 16, std::size_t buffers = 3, stream_record record = PACKED)
+            : _chunk((std::max<std::size_t>(chunk, 1) + detail::LANES - 1) / detail::LANES * detail::LANES),
+              _buffers(std::max<std::size_t>(buffers, 1)),
+              _record_bytes(record == RAW ? sizeof(T) : sizeof(float) * (std::is_same_v<T, float3> ? 3 : 4)) {}
+
+        inline std::size_t chunk_size() const { return _chunk; }
+        /* bytes per record in the input and output files */
+        inline std::size_t record_size() const { return _record_bytes; }
+
+        stream_pipeline &then(char const *name, kernel k) {
+            _kernels.emplace_back(name, std::move(k));
+            return *this;
+        }
+
+        /* Calls f(data, count) on every chunk that reaches this point, without changing it */
+        template<typename F>
+        stream_pipeline &reduce(char const *name, F f) {
+            return then(name, [f](T *data, std::size_t count) mutable {
+                f(static_cast<T const *>(data), count);
+                return count;
+            });
+        }
+
+        /* float4 are transformed as given, float3 as points (w = 1) */
+        stream_pipeline &transform(float4x4 const &m) {
+            return then("transform", [m](T *data, std::size_t count) {
+                if constexpr (std::is_same_v<T, float3>) {
+                    transform_points(m, data, data, count);
+                } else {
+                    mathsimd::transform(m, data, data, count);
+                }
+                return count;
+            });
+        }
+
+        stream_pipeline &normalize() {
+            return then("normalize", [](T *data, std::size_t count) {
+                mathsimd::normalize(data, data, count);
+                return count;
+            });
+        }
+
+        stream_pipeline &cull(float3 const &lo, float3 const &hi) {
+            return then("cull", [lo, hi](T *data, std::size_t count) {
+                return mathsimd::cull(data, data, count, lo, hi);
+            });
+        }
+
+        /* Component-wise bounds of everything that reaches this stage. lo and hi are reset
+         * here, must outlive run() and stay at +inf / -inf if nothing arrives. */
+        stream_pipeline &bounds(T &lo, T &hi) {
+            float const inf = std::numeric_limits<float>::infinity();
+            _mm_store_ps(&lo.x(), _mm_set1_ps(inf));
+            _mm_store_ps(&hi.x(), _mm_set1_ps(-inf));
+            return reduce("bounds", [&lo, &hi](T const *data, std::size_t count) {
+                __m128 mn = _mm_load_ps(&lo.x());
+                __m128 mx = _mm_load_ps(&hi.x());
+                for (std::size_t i = 0; i < count; ++i) {
+                    __m128 const p = static_cast<__m128>(data[i]);
+                    mn = _mm_min_ps(mn, p);
+                    mx = _mm_max_ps(mx, p);
+                }
+                _mm_store_ps(&lo.x(), mn);
+                _mm_store_ps(&hi.x(), mx);
+            });
+        }
+
+        /* Streams in_fd to the end through the kernels into out_fd; pass out_fd = -1 to only
+         * run the kernels (e.g. for reductions). Stops at the first read or write error. */
+        stream_stats run(int in_fd, int out_fd) const {
+            auto const start = std::chrono::steady_clock::now();
+            stream_stats stats;
+            for (auto const &k : _kernels) {
+                stats.kernels.push_back(stream_stage_stats{k.first});
+            }
+#ifdef POSIX_FADV_SEQUENTIAL
+            // lets the kernel read ahead further; fails harmlessly on pipes
+            posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+            bool const packed = _record_bytes != sizeof(T);
+            std::vector<chunk> pool(_buffers);
+            detail::chunk_queue<chunk> empty, filled, computed;
+            for (auto &c : pool) {
+                c.data.resize(_chunk);
+                if (packed) { c.packed.resize(_chunk * _record_bytes / sizeof(float)); }
+                empty.push(&c);
+            }
+            std::atomic<int> error{0};
+            bool truncated = false;
+            auto fail = [&](int e) {
+                int expected = 0;
+                error.compare_exchange_strong(expected, e);
+            };
+
+            std::thread reader([&] {
+                while (!error.load(std::memory_order_relaxed)) {
+                    chunk *c = empty.pop(stats.read.wait_ns);
+                    if (!c) { break; }
+                    auto const t = std::chrono::steady_clock::now();
+                    void *dst = packed ? static_cast<void *>(c->packed.data()) : static_cast<void *>(c->data.data());
+                    ssize_t const bytes = detail::read_full(in_fd, dst, _chunk * _record_bytes);
+                    if (bytes < 0) {
+                        fail(errno);
+                        break;
+                    }
+                    // the input can only end mid-record; keep the whole records before it
+                    truncated = bytes % _record_bytes != 0;
+                    std::size_t const count = static_cast<std::size_t>(bytes) / _record_bytes;
+                    if constexpr (std::is_same_v<T, float3>) {
+                        if (packed) { detail::widen_xyz(c->packed.data(), c->data.data(), count); }
+                    }
+                    stats.read.busy_ns += detail::elapsed_ns(t);
+                    stats.read.elements += count;
+                    stats.read.bytes += static_cast<uint64_t>(bytes);
+                    if (!count) { break; }
+                    c->count = count;
+                    filled.push(c);
+                    if (count < _chunk || truncated) { break; }
+                }
+                filled.close();
+            });
+
+            std::thread writer([&] {
+                while (chunk *c = computed.pop(stats.write.wait_ns)) {
+                    if (out_fd >= 0 && !error.load(std::memory_order_relaxed)) {
+                        auto const t = std::chrono::steady_clock::now();
+                        void const *src = c->data.data();
+                        if constexpr (std::is_same_v<T, float3>) {
+                            if (packed) {
+                                detail::pack_xyz(c->data.data(), c->packed.data(), c->count);
+                                src = c->packed.data();
+                            }
+                        }
+                        if (detail::write_full(out_fd, src, c->count * _record_bytes)) {
+                            stats.write.busy_ns += detail::elapsed_ns(t);
+                            stats.write.elements += c->count;
+                            stats.write.bytes += c->count * _record_bytes;
+                        } else {
+                            fail(errno);
+                        }
+                    }
+                    empty.push(c);
+                }
+                empty.close();
+            });
+
+            while (chunk *c = filled.pop(stats.compute.wait_ns)) {
+                if (!error.load(std::memory_order_relaxed)) {
+                    auto const t = std::chrono::steady_clock::now();
+                    stats.compute.elements += c->count;
+                    stats.compute.bytes += c->count * sizeof(T);
+                    for (std::size_t k = 0; k < _kernels.size() && c->count; ++k) {
+                        auto const tk = std::chrono::steady_clock::now();
+                        stats.kernels[k].elements += c->count;
+                        stats.kernels[k].bytes += c->count * sizeof(T);
+                        c->count = _kernels[k].second(c->data.data(), c->count);
+                        stats.kernels[k].busy_ns += detail::elapsed_ns(tk);
+                    }
+                    stats.compute.busy_ns += detail::elapsed_ns(t);
+                }
+                computed.push(c);
+            }
+            computed.close();
+            reader.join();
+            writer.join();
+
+            stats.error = error.load();
+            if (!stats.error && truncated) { stats.error = EINVAL; }
+            stats.wall_ns = detail::elapsed_ns(start);
+            return stats;
+        }
+    };
+
+}
+
+#endif //MATHEMATICS_STREAM_HPP
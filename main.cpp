@@ -10,6 +10,21 @@ int main() {
         mathtests::test_float4_cross();
         mathtests::test_float4x4_matmul();
         mathtests::test_float4x4_vecmul();
+        mathtests::test_float2x2_matmul();
+        mathtests::test_float3x3_matmul();
+        mathtests::test_float4x4_batch_matmul();
+    }
+
+    for (auto i = 0; i < 10; ++i) {
+        mathtests::test_float3x3_svd();
+        mathtests::test_float3x3_polar();
+        mathtests::test_batched_solve();
+        mathtests::test_batched_least_squares();
+        mathtests::test_random_fill();
+        mathtests::test_morton_order();
+        mathtests::test_batch_kernels();
+        mathtests::test_profile();
+        mathtests::test_stream_pipeline();
     }
 
     return 0;
@@ -7,6 +7,13 @@
 #include <cassert>
 #include <iostream>
 #include <chrono>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
 constexpr unsigned int TESTS = 1000000u;
 constexpr unsigned int VALUES = 100u;
 constexpr int SEED = 1234;
@@ -149,6 +156,587 @@ void mathtests::test_float4x4_vecmul() {
     assert((tmp == out).all_true());
 }
 
+void mathtests::test_float2x2_matmul() {
+    using namespace mathsimd;
+    float A[4], B[4], v[2];
+    for (auto &i: A) { i = rnd(); }
+    for (auto &i: B) { i = rnd(); }
+    for (auto &i: v) { i = rnd(); }
+    float2x2 a(float2(A), float2(A + 2));
+    float2x2 b(float2(B), float2(B + 2));
+    float2x2 out = matmul(a, b);
+    float2 vout = matmul(a, float2(v));
+    for (int j = 0; j < 2; ++j) {
+        for (int i = 0; i < 2; ++i) {
+            assert(std::fabs(out[j][i] - (A[i]*B[2*j] + A[2+i]*B[2*j+1])) < EPSILON_F);
+        }
+    }
+    assert((vout == float2(A[0]*v[0] + A[2]*v[1], A[1]*v[0] + A[3]*v[1])).all_true());
+}
+
+void mathtests::test_float3x3_matmul() {
+    using namespace mathsimd;
+    float A[9], B[9], v[3];
+    for (auto &i: A) { i = rnd(); }
+    for (auto &i: B) { i = rnd(); }
+    for (auto &i: v) { i = rnd(); }
+    float3x3 a(float3(A[0],A[1],A[2]), float3(A[3],A[4],A[5]), float3(A[6],A[7],A[8]));
+    float3x3 b(float3(B[0],B[1],B[2]), float3(B[3],B[4],B[5]), float3(B[6],B[7],B[8]));
+    float3x3 out = matmul(a, b);
+    float3 vout = matmul(a, float3(v[0],v[1],v[2]));
+    float ref_v[3];
+    for (int j = 0; j < 3; ++j) {
+        ref_v[j] = A[j]*v[0] + A[3+j]*v[1] + A[6+j]*v[2];
+        for (int i = 0; i < 3; ++i) {
+            assert(std::fabs(out[j][i] - (A[i]*B[3*j] + A[3+i]*B[3*j+1] + A[6+i]*B[3*j+2])) < EPSILON_F);
+        }
+    }
+    assert((vout == float3(ref_v[0],ref_v[1],ref_v[2])).all_true());
+
+    float3x3 sum = a + b * 2.f - 1.f;
+    for (int e = 0; e < 9; ++e) {
+        assert(std::fabs(sum[0][e] - (A[e] + B[e] * 2.f - 1.f)) < EPSILON_F);
+    }
+}
+
+/* Random matrices plus the degenerate cases the Jacobi sweeps must survive */
+static std::vector<mathsimd::float3x3> decomposition_cases() {
+    using namespace mathsimd;
+    std::vector<float3x3> cases;
+    for (int n = 0; n < 61; ++n) {
+        float3x3 m;
+        for (int e = 0; e < 9; ++e) { m[0][e] = 2.f * rnd() - 1.f; }
+        cases.push_back(m);
+    }
+    cases.push_back(float3x3());
+    cases.push_back(float3x3::identity());
+    cases.push_back(float3x3(float3(1,0,0), float3(0,1,0), float3(0,0,-1)));
+    cases.push_back(float3x3(float3(0,2,0), float3(-2,0,0), float3(0,0,2)));
+    cases.push_back(float3x3(float3(1,2,3), float3(2,4,6), float3(-1,-2,-3)));
+    cases.push_back(float3x3(float3(1,2,3), float3(0,1,0), float3(1,3,3)));
+    cases.push_back(float3x3(float3(1e-3f,0,0), float3(0,1e3f,0), float3(0,0,1)));
+    // the same random matrices far from unit scale, where squared norms would overflow or underflow
+    for (float scale : {1e-20f, 1e-12f, 1e-6f, 1e9f, 1e12f, 1e20f}) {
+        for (int n = 0; n < 8; ++n) { cases.push_back(cases[n] * scale); }
+        cases.push_back(float3x3(float3(1,2,3), float3(2,4,6), float3(-1,-2,-3)) * scale);
+    }
+    return cases;
+}
+
+static float max_abs_diff(mathsimd::float3x3 const &a, mathsimd::float3x3 const &b) {
+    float err = 0.f;
+    for (int e = 0; e < 9; ++e) { err = std::max(err, std::fabs(a[0][e] - b[0][e])); }
+    return err;
+}
+
+static float scale_of(mathsimd::float3x3 const &a) {
+    float s = std::numeric_limits<float>::min();
+    for (int e = 0; e < 9; ++e) { s = std::max(s, std::fabs(a[0][e])); }
+    return s;
+}
+
+static mathsimd::float3x3 transpose(mathsimd::float3x3 const &a) {
+    mathsimd::float3x3 t;
+    for (int j = 0; j < 3; ++j)
+        for (int i = 0; i < 3; ++i)
+            t[j][i] = a[i][j];
+    return t;
+}
+
+// scalar, since float3 dot and cross also read the padding lane, which float3x3::c0() leaves unset
+static float det(mathsimd::float3x3 const &a) {
+    return a[0][0] * (a[1][1] * a[2][2] - a[2][1] * a[1][2])
+         - a[1][0] * (a[0][1] * a[2][2] - a[2][1] * a[0][2])
+         + a[2][0] * (a[0][1] * a[1][2] - a[1][1] * a[0][2]);
+}
+
+void mathtests::test_float3x3_svd() {
+    using namespace mathsimd;
+    constexpr float tolerance = 1e-5f;
+    auto cases = decomposition_cases();
+    std::vector<float3x3> u(cases.size()), v(cases.size());
+    std::vector<float3> s(cases.size());
+    svd(cases.data(), u.data(), s.data(), v.data(), cases.size());
+    for (size_t n = 0; n < cases.size(); ++n) {
+        float3x3 sigma(float3(s[n].x(),0,0), float3(0,s[n].y(),0), float3(0,0,s[n].z()));
+        float3x3 rebuilt = matmul(matmul(u[n], sigma), transpose(v[n]));
+        assert(max_abs_diff(rebuilt, cases[n]) < tolerance * scale_of(cases[n]));
+        assert(max_abs_diff(matmul(transpose(u[n]), u[n]), float3x3::identity()) < tolerance);
+        assert(max_abs_diff(matmul(transpose(v[n]), v[n]), float3x3::identity()) < tolerance);
+        assert(std::fabs(det(u[n]) - 1.f) < tolerance && std::fabs(det(v[n]) - 1.f) < tolerance);
+        assert(s[n].x() >= s[n].y() && s[n].y() >= std::fabs(s[n].z()));
+    }
+}
+
+void mathtests::test_float3x3_polar() {
+    using namespace mathsimd;
+    constexpr float tolerance = 1e-5f;
+    auto cases = decomposition_cases();
+    std::vector<float3x3> r(cases.size()), p(cases.size());
+    polar(cases.data(), r.data(), p.data(), cases.size());
+    for (size_t n = 0; n < cases.size(); ++n) {
+        assert(max_abs_diff(matmul(r[n], p[n]), cases[n]) < tolerance * scale_of(cases[n]));
+        assert(max_abs_diff(matmul(transpose(r[n]), r[n]), float3x3::identity()) < tolerance);
+        assert(std::fabs(det(r[n]) - 1.f) < tolerance);
+        assert(max_abs_diff(p[n], transpose(p[n])) < tolerance * scale_of(cases[n]));
+    }
+}
+
+template<int N, typename Matrix, typename Vector>
+static float residual(Matrix const &a, Vector const &x, Vector const &b) {
+    float err = 0.f;
+    for (int i = 0; i < N; ++i) {
+        float sum = 0.f;
+        for (int j = 0; j < N; ++j) { sum += a[j][i] * static_cast<float const *>(x)[j]; }
+        err = std::max(err, std::fabs(sum - static_cast<float const *>(b)[i]));
+    }
+    return err;
+}
+
+void mathtests::test_batched_solve() {
+    using namespace mathsimd;
+    constexpr size_t count = 21;
+    std::vector<float4x4> a4(count), spd4(count);
+    std::vector<float4> b4(count), x4(count);
+    std::vector<float3x3> a3(count);
+    std::vector<float3> b3(count), x3(count);
+    bool singular[count];
+    // a generator of its own keeps the systems fixed however many rnd() calls ran before
+    uint32_t state = SEED;
+    auto next = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return 2.f * static_cast<float>(state >> 8) / 16777216.f - 1.f;
+    };
+    for (size_t n = 0; n < count; ++n) {
+        // even systems are general matrices that need partial pivoting, odd ones are diagonally dominant
+        float const boost = n % 2 ? 1.f : 0.f;
+        for (int e = 0; e < 16; ++e) { a4[n][0][e] = next() + (e % 5 == 0 ? 4.f * boost : 0.f); }
+        for (int e = 0; e < 9; ++e) { a3[n][0][e] = next() + (e % 4 == 0 ? 3.f * boost : 0.f); }
+        b4[n] = float4(next(), next(), next(), next());
+        b3[n] = float3(next(), next(), next());
+        // m^T m + I is symmetric positive definite
+        for (int j = 0; j < 4; ++j)
+            for (int i = 0; i < 4; ++i)
+                spd4[n][j][i] = dot(float4(a4[n][i]), float4(a4[n][j])) + (i == j);
+    }
+    // a zero pivot column forces a row swap, and a repeated column makes the system singular
+    a4[0] = float4x4(float4(0,1,0,0), float4(1,0,0,0), float4(0,0,0,1), float4(0,0,1,0));
+    a4[5] = float4x4(a4[5].c0(), a4[5].c0() * 2.f, a4[5].c2(), a4[5].c3());
+    a3[7] = float3x3(a3[7].c0(), a3[7].c1(), a3[7].c0() - a3[7].c1());
+
+    solve(a4.data(), b4.data(), x4.data(), singular, count);
+    for (size_t n = 0; n < count; ++n) {
+        assert(singular[n] == (n == 5));
+        assert(singular[n] || (residual<4>(a4[n], x4[n], b4[n]) < 1e-3f));
+    }
+    solve(a3.data(), b3.data(), x3.data(), singular, count);
+    for (size_t n = 0; n < count; ++n) {
+        assert(singular[n] == (n == 7));
+        assert(singular[n] || (residual<3>(a3[n], x3[n], b3[n]) < 1e-3f));
+    }
+    solve_spd(spd4.data(), b4.data(), x4.data(), singular, count);
+    for (size_t n = 0; n < count; ++n) {
+        assert(!singular[n]);
+        assert(residual<4>(spd4[n], x4[n], b4[n]) < 1e-3f);
+    }
+    spd4[3][2][2] = -1.f;
+    solve_spd(spd4.data(), b4.data(), x4.data(), singular, count);
+    assert(singular[3] && (x4[3] == float4::zero()).all_true());
+}
+
+void mathtests::test_batched_least_squares() {
+    using namespace mathsimd;
+    constexpr int M = 6, N = 3;
+    constexpr size_t count = 11;
+    std::vector<float> a(count * M * N), b(count * M), x(count * N), expected(count * N);
+    bool singular[count];
+    for (auto &v: a) { v = 2.f * rnd() - 1.f; }
+    for (auto &v: expected) { v = rnd(); }
+    // duplicate a column to make one system rank deficient
+    for (int r = 0; r < M; ++r) { a[4 * M * N + 2 * M + r] = a[4 * M * N + r]; }
+    for (size_t n = 0; n < count; ++n) {
+        for (int r = 0; r < M; ++r) {
+            float sum = 0.f;
+            for (int c = 0; c < N; ++c) { sum += a[n * M * N + c * M + r] * expected[n * N + c]; }
+            b[n * M + r] = sum;
+        }
+    }
+    least_squares<M, N>(a.data(), b.data(), x.data(), singular, count);
+    for (size_t n = 0; n < count; ++n) {
+        assert(singular[n] == (n == 4));
+        for (int c = 0; !singular[n] && c < N; ++c) {
+            assert(std::fabs(x[n * N + c] - expected[n * N + c]) < 1e-3f);
+        }
+    }
+}
+
+void mathtests::test_random_fill() {
+    using namespace mathsimd;
+    constexpr size_t count = 1003;
+    rng g(SEED);
+    std::vector<float> u(count);
+    fill_uniform(g, u.data(), count, -2.f, 3.f);
+    float mean = 0.f;
+    for (auto v: u) {
+        assert(v >= -2.f && v < 3.f);
+        mean += v / count;
+    }
+    assert(std::fabs(mean - 0.5f) < 0.25f);
+
+    std::vector<float3> p(count);
+    fill_box(g, p.data(), count, float3(-1,0,2), float3(1,1,4));
+    for (auto const &v: p) {
+        assert(v.x() >= -1.f && v.x() < 1.f && v.y() >= 0.f && v.y() < 1.f && v.z() >= 2.f && v.z() < 4.f);
+    }
+    fill_unit_sphere(g, p.data(), count);
+    for (auto const &v: p) { assert(std::fabs(dot(v, v) - 1.f) < 1e-5f); }
+    fill_unit_ball(g, p.data(), count);
+    for (auto const &v: p) { assert(dot(v, v) < 1.f); }
+
+    std::vector<float4> q(count);
+    fill_rotation(g, q.data(), count);
+    for (auto const &v: q) { assert(std::fabs(dot(v, v) - 1.f) < 1e-5f); }
+    std::vector<float4x4> m(count);
+    fill_rotation(g, m.data(), count);
+    for (auto const &r: m) {
+        assert(std::fabs(dot(r.c0(), r.c1())) < 1e-5f && std::fabs(dot(r.c0(), r.c2())) < 1e-5f);
+        assert(std::fabs(dot(r.c0(), r.c0()) - 1.f) < 1e-5f && std::fabs(dot(r.c2(), r.c2()) - 1.f) < 1e-5f);
+        assert((cross(r.c0(), r.c1()) == r.c2()).all_true() && (r.c3() == float4::in()).all_true());
+    }
+
+    // the largest u rounds lo + u * (hi - lo) up to hi, which must stay excluded
+    __m256 const top = detail::uniform_range(_mm256_set1_ps(1.f - 1.f / 16777216.f), 2.f, 4.f);
+    assert(_mm256_cvtss_f32(top) < 4.f && _mm256_cvtss_f32(top) > 3.999f);
+    assert(_mm256_cvtss_f32(detail::uniform_range(_mm256_setzero_ps(), 2.f, 4.f)) == 2.f);
+
+    // independent streams must not produce the same sequence
+    rng a(SEED, 0), b(SEED, 1);
+    assert(_mm256_movemask_epi8(_mm256_cmpeq_epi32(a.next(), b.next())) != -1);
+
+    // the scalar step against the reference outputs of xoshiro128** from state {1, 2, 3, 4}
+    uint32_t s[4]{1, 2, 3, 4};
+    assert(detail::xoshiro128_next(s) == 11520u && detail::xoshiro128_next(s) == 0u);
+    assert(detail::xoshiro128_next(s) == 5927040u);
+
+    // lane 0 runs the seeded scalar generator, lane 1 the same state one jump later
+    uint64_t seed = SEED;
+    uint64_t const v0 = detail::splitmix64(seed), v1 = detail::splitmix64(seed);
+    uint32_t lane0[4]{static_cast<uint32_t>(v0), static_cast<uint32_t>(v0 >> 32),
+                      static_cast<uint32_t>(v1), static_cast<uint32_t>(v1 >> 32)};
+    uint32_t lane1[4]{lane0[0], lane0[1], lane0[2], lane0[3]};
+    detail::xoshiro128_jump(lane1, detail::XOSHIRO128_JUMP);
+    rng c(SEED);
+    for (int i = 0; i < 100; ++i) {
+        alignas(32) uint32_t out[8];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(out), c.next());
+        assert(out[0] == detail::xoshiro128_next(lane0));
+        assert(out[1] == detail::xoshiro128_next(lane1));
+    }
+
+    // every thread gets its own stream from local()
+    alignas(32) uint32_t first[2][8];
+    for (int t = 0; t < 2; ++t) {
+        std::thread([&first, t] {
+            _mm256_store_si256(reinterpret_cast<__m256i *>(first[t]), rng::local().next());
+        }).join();
+    }
+    assert(!std::equal(first[0], first[0] + 8, first[1]));
+}
+
+void mathtests::test_morton_order() {
+    using namespace mathsimd;
+    constexpr size_t count = 1029;
+    std::vector<float3> points(count);
+    rng g(SEED);
+    fill_box(g, points.data(), count, float3(-5,-5,-5), float3(5,5,5));
+    float3 lo, hi;
+    bounds(points.data(), count, lo, hi);
+
+    std::vector<uint32_t> k32(count);
+    std::vector<uint64_t> k64(count);
+    morton_encode(points.data(), count, lo, hi, k32.data());
+    morton_encode(points.data(), count, lo, hi, k64.data());
+    for (size_t n = 0; n < count; ++n) {
+        uint32_t c32 = 0;
+        uint64_t c64 = 0;
+        for (int a = 0; a < 3; ++a) {
+            // quantise exactly as the encoder does: offset * (max_cell / extent), truncated and clamped
+            float const offset = static_cast<float const *>(points[n])[a] - static_cast<float const *>(lo)[a];
+            float const extent = static_cast<float const *>(hi)[a] - static_cast<float const *>(lo)[a];
+            auto const q32 = static_cast<uint32_t>(std::clamp(static_cast<int>(offset * (1023.f / extent)), 0, 1023));
+            auto const q64 = static_cast<uint64_t>(std::clamp(static_cast<int>(offset * (2097151.f / extent)), 0, 2097151));
+            for (int b = 0; b < 21; ++b) {
+                c32 |= b < 10 ? ((q32 >> b) & 1u) << (3 * b + a) : 0u;
+                c64 |= ((q64 >> b) & 1ull) << (3 * b + a);
+            }
+        }
+        assert(k32[n] == c32);
+        assert(k64[n] == c64);
+    }
+
+    for (unsigned threads : {1u, 4u}) {
+        std::vector<uint32_t> keys(1 << 18), values(keys.size());
+        for (size_t n = 0; n < keys.size(); ++n) {
+            keys[n] = static_cast<uint32_t>(n * 2654435761u) >> 8;
+            values[n] = static_cast<uint32_t>(n);
+        }
+        auto expected = keys;
+        std::stable_sort(expected.begin(), expected.end());
+        auto original = keys;
+        radix_sort(keys.data(), values.data(), keys.size(), threads);
+        assert(keys == expected);
+        for (size_t n = 0; n < keys.size(); ++n) {
+            assert(original[values[n]] == keys[n]);
+            assert(n == 0 || keys[n - 1] != keys[n] || values[n - 1] < values[n]);
+        }
+    }
+
+    std::vector<uint32_t> order(count);
+    morton_order(points.data(), count, order.data());
+    std::vector<float3> sorted(count), restored(count);
+    gather(points.data(), order.data(), sorted.data(), count);
+    scatter(sorted.data(), order.data(), restored.data(), count);
+    for (size_t n = 0; n < count; ++n) {
+        assert(k32[order[n]] >= k32[order[n > 0 ? n - 1 : 0]]);
+        assert((restored[n] == points[n]).all_true());
+    }
+}
+
+void mathtests::test_float4x4_batch_matmul() {
+    using namespace mathsimd;
+    constexpr size_t count = 37;
+    std::vector<float4x4> a(count), b(count), out(count);
+    for (size_t n = 0; n < count; ++n) {
+        a[n] = copy(randmat());
+        b[n] = copy(randmat());
+    }
+    float4x4_batch ba(a.data(), count), bb(b.data(), count), bout;
+    bb.store(out.data());
+    assert(!memcmp(out.data(), b.data(), count * sizeof(float4x4)));
+
+    matmul(ba, bb, bout);
+    assert(bout.size() == count);
+    bout.store(out.data());
+    for (size_t n = 0; n < count; ++n) {
+        float4x4 expected = matmul(a[n], b[n]);
+        for (int e = 0; e < 16; ++e) {
+            assert(std::fabs(out[n][0][e] - expected[0][e]) < EPSILON_F);
+        }
+    }
+
+    // matmul() picks the widest kernel the target supports; check the 8-lane AVX2 one too
+    float4x4_batch b8(count);
+    detail::batch_matmul<detail::lanes8>(ba.block(0), bb.block(0), b8.block(0), b8.blocks());
+    b8.store(out.data());
+    for (size_t n = 0; n < count; ++n) {
+        float4x4 expected = matmul(a[n], b[n]);
+        for (int e = 0; e < 16; ++e) {
+            assert(std::fabs(out[n][0][e] - expected[0][e]) < EPSILON_F);
+        }
+    }
+
+    // a moved-from batch is empty, can be copied and still works as an output
+    float4x4_batch moved(std::move(bout));
+    assert(moved.size() == count && bout.size() == 0 && bout.blocks() == 0);
+    bout.store(out.data());
+    float4x4_batch empty(bout);
+    assert(empty.size() == 0);
+    bout = std::move(moved);
+    assert(bout.size() == count && moved.size() == 0);
+    matmul(ba, bb, moved);
+    assert(moved.size() == count && !memcmp(moved.block(0), bout.block(0), float4x4_batch::BLOCK * sizeof(float)));
+}
+
+void mathtests::test_batch_kernels() {
+    using namespace mathsimd;
+    constexpr size_t count = 45;
+    float4x4 m = copy(randmat());
+    std::vector<float4> v(count), tv(count);
+    std::vector<float3> p(count), tp(count);
+    rng g(SEED);
+    fill_box(g, v.data(), count, float4(-1,-1,-1,-1), float4(1,1,1,1));
+    fill_box(g, p.data(), count, float3(-1,-1,-1), float3(1,1,1));
+    p[3] = float3::zero();
+
+    transform(m, v.data(), tv.data(), count);
+    transform_points(m, p.data(), tp.data(), count);
+    for (size_t n = 0; n < count; ++n) {
+        assert((tv[n] == matmul(m, v[n])).all_true());
+        float4 expected = matmul(m, float4(p[n], 1.f));
+        assert((tp[n] == float3(expected.x(), expected.y(), expected.z())).all_true());
+    }
+
+    normalize(v.data(), tv.data(), count);
+    normalize(p.data(), tp.data(), count);
+    for (size_t n = 0; n < count; ++n) {
+        assert(std::fabs(dot(tv[n], tv[n]) - 1.f) < 1e-5f);
+        assert(n == 3 ? (tp[n] == float3::zero()).all_true() : std::fabs(dot(tp[n], tp[n]) - 1.f) < 1e-5f);
+    }
+}
+
+void mathtests::test_profile() {
+    using namespace mathsimd;
+    static profile::kernel const k("test kernel");
+    for (int i = 0; i < 3; ++i) {
+        profile::scope s(k, 100);
+    }
+#ifdef MATHSIMD_PROFILE
+    std::vector<float4> v(16);
+    normalize(v.data(), v.data(), v.size());
+#endif
+    bool found_test = false, found_normalize = false;
+    for (auto const &[name, t] : profile::summary()) {
+        if (std::string_view(name) == "test kernel") {
+            found_test = t.calls >= 3 && t.elements == t.calls * 100;
+        }
+        found_normalize |= std::string_view(name) == "normalize float4" && t.calls > 0;
+    }
+    assert(found_test);
+#ifdef MATHSIMD_PROFILE
+    assert(found_normalize);
+#else
+    assert(!found_normalize);
+#endif
+    std::ostringstream trace;
+    profile::write_chrome_trace(trace);
+    assert(trace.str().find("\"name\":\"test kernel\",\"ph\":\"X\"") != std::string::npos);
+
+    // an exited thread's totals and events outlive its buffer
+    static profile::kernel const worker_kernel("test worker");
+    auto worker_calls = [] {
+        for (auto const &[name, t] : profile::summary()) {
+            if (std::string_view(name) == "test worker") { return t.calls; }
+        }
+        return uint64_t{0};
+    };
+    std::size_t const live = profile::live_threads();
+    uint64_t const before = worker_calls();
+    std::thread([] { profile::scope s(worker_kernel, 1); }).join();
+    assert(profile::live_threads() == live);
+    assert(worker_calls() == before + 1);
+    trace.str("");
+    profile::write_chrome_trace(trace);
+    assert(trace.str().find("\"name\":\"test worker\",\"ph\":\"X\"") != std::string::npos);
+
+    // reporting from a thread does not register it
+    std::thread([live] {
+        std::ostringstream out;
+        profile::report(out);
+        assert(out.str().find("test worker") != std::string::npos);
+        assert(profile::live_threads() == live);
+    }).join();
+
+    // with no event capacity a new thread keeps totals only
+    profile::set_event_capacity(0);
+    std::thread([] {
+        profile::scope s(worker_kernel, 1);
+        assert(profile::local().events.load() == nullptr);
+    }).join();
+    profile::set_event_capacity(profile::MAX_EVENTS);
+    assert(worker_calls() == before + 2);
+}
+
+void mathtests::test_stream_pipeline() {
+    using namespace mathsimd;
+    constexpr size_t count = 10007;
+    float4x4 m = copy(randmat());
+    std::vector<float3> p(count);
+    rng g(SEED);
+    fill_box(g, p.data(), count, float3(-1,-1,-1), float3(1,1,1));
+    float3 const lo(-0.5f,-0.5f,-0.5f), hi(0.5f,0.5f,0.5f);
+
+    // the same chain run on the whole array at once
+    std::vector<float3> expected(count);
+    transform_points(m, p.data(), expected.data(), count);
+    size_t const kept = cull(expected.data(), expected.data(), count, lo, hi);
+    normalize(expected.data(), expected.data(), kept);
+
+    // files hold packed xyz records
+    std::vector<float> xyz(3 * count);
+    for (size_t n = 0; n < count; ++n) {
+        xyz[3 * n] = p[n].x();
+        xyz[3 * n + 1] = p[n].y();
+        xyz[3 * n + 2] = p[n].z();
+    }
+
+    // feed a pipe in pieces that split records, so reads come back short
+    int fds[2];
+    int status = pipe(fds);
+    assert(status == 0);
+    std::thread feeder([&] {
+        char const *bytes = reinterpret_cast<char const *>(xyz.data());
+        for (size_t done = 0, piece = 1000; done < xyz.size() * sizeof(float); done += piece) {
+            piece = std::min(piece, xyz.size() * sizeof(float) - done);
+            ssize_t const written = write(fds[1], bytes + done, piece);
+            assert(written == static_cast<ssize_t>(piece));
+        }
+        close(fds[1]);
+    });
+    FILE *out = tmpfile();
+    float3 blo, bhi;
+    stream_stats stats = stream_pipeline<float3>(1000, 3)
+            .transform(m).cull(lo, hi).normalize().bounds(blo, bhi)
+            .run(fds[0], fileno(out));
+    feeder.join();
+    close(fds[0]);
+
+    assert(stats.error == 0);
+    assert(stats.read.elements == count && stats.compute.elements == count);
+    assert(stats.read.bytes == 12 * count && stats.write.bytes == 12 * kept);
+    assert(stats.kernels.size() == 4 && stats.kernels[1].elements == count);
+    assert(stats.kernels[2].elements == kept && stats.write.elements == kept);
+    assert(kept > 0 && kept < count);
+
+    std::vector<float> result(3 * kept);
+    rewind(out);
+    size_t const stored = fread(result.data(), sizeof(float), result.size() + 1, out);
+    assert(stored == result.size());
+    fclose(out);
+    float3 elo(1,1,1), ehi(-1,-1,-1);
+    for (size_t n = 0; n < kept; ++n) {
+        assert(result[3 * n] == expected[n].x() && result[3 * n + 1] == expected[n].y() && result[3 * n + 2] == expected[n].z());
+        elo = float3(std::min(elo.x(), expected[n].x()), std::min(elo.y(), expected[n].y()), std::min(elo.z(), expected[n].z()));
+        ehi = float3(std::max(ehi.x(), expected[n].x()), std::max(ehi.y(), expected[n].y()), std::max(ehi.z(), expected[n].z()));
+    }
+    assert(blo.x() == elo.x() && blo.y() == elo.y() && blo.z() == elo.z());
+    assert(bhi.x() == ehi.x() && bhi.y() == ehi.y() && bhi.z() == ehi.z());
+
+    // a trailing partial record is reported, and the whole records before it still go through
+    status = pipe(fds);
+    assert(status == 0);
+    ssize_t const truncated = write(fds[1], xyz.data(), 3 * 12 + 4);
+    assert(truncated == 3 * 12 + 4);
+    close(fds[1]);
+    out = tmpfile();
+    stats = stream_pipeline<float3>(8).run(fds[0], fileno(out));
+    close(fds[0]);
+    assert(stats.error == EINVAL);
+    assert(stats.read.elements == 3 && stats.write.elements == 3);
+    rewind(out);
+    float head[10];
+    size_t const partial = fread(head, sizeof(float), 10, out);
+    fclose(out);
+    assert(partial == 9);
+    for (size_t n = 0; n < 9; ++n) { assert(head[n] == xyz[n]); }
+
+    // RAW keeps the 16-byte in-memory layout on disk
+    status = pipe(fds);
+    assert(status == 0);
+    ssize_t const raw = write(fds[1], p.data(), 5 * sizeof(float3));
+    assert(raw == 5 * sizeof(float3));
+    close(fds[1]);
+    out = tmpfile();
+    stats = stream_pipeline<float3>(8, 3, RAW).run(fds[0], fileno(out));
+    close(fds[0]);
+    assert(stats.error == 0 && stats.write.bytes == 5 * sizeof(float3));
+    rewind(out);
+    float3 records[6];
+    size_t const whole = fread(records, sizeof(float3), 6, out);
+    fclose(out);
+    assert(whole == 5);
+    for (size_t n = 0; n < 5; ++n) { assert((records[n] == p[n]).all_true()); }
+}
+
 static std::array<mathsimd::float3,VALUES>& generate_simd_vectors() {
     static bool created = false;
     static std::array<mathsimd::float3,VALUES> test_cases;
@@ -190,3 +778,39 @@ void mathtests::benchmark_simd_cross() {
     std::cout<<"Value of sum is "<<c<<std::endl;
 }
 
+void mathtests::benchmark_batched_matmul() {
+    using namespace mathsimd;
+    using namespace std::chrono;
+    // one size that stays in cache and one that streams from memory
+    for (size_t count : {4096ul, 100000ul}) {
+        size_t const rounds = 2000000 / count;
+        std::vector<float4x4> a(count), b(count), out(count);
+        rng g(SEED);
+        fill_uniform(g, &a[0][0][0], 16 * count);
+        fill_uniform(g, &b[0][0][0], 16 * count);
+
+        auto start = high_resolution_clock::now();
+        for (size_t r = 0; r < rounds; ++r) {
+            for (size_t n = 0; n < count; ++n) { out[n] = matmul(a[n], b[n]); }
+        }
+        double per_call = duration_cast<duration<double>>(high_resolution_clock::now() - start).count();
+
+        float4x4_batch ba(a.data(), count), bb(b.data(), count), bout(count);
+        start = high_resolution_clock::now();
+        for (size_t r = 0; r < rounds; ++r) { matmul(ba, bb, bout); }
+        double batched = duration_cast<duration<double>>(high_resolution_clock::now() - start).count();
+
+        start = high_resolution_clock::now();
+        for (size_t r = 0; r < rounds; ++r) {
+            ba.load(a.data());
+            bb.load(b.data());
+            matmul(ba, bb, bout);
+            bout.store(out.data());
+        }
+        double converted = duration_cast<duration<double>>(high_resolution_clock::now() - start).count();
+
+        std::cout<<"Matmul x"<<count<<" per call: "<<count * rounds / per_call * 1e-6<<" Mmat/s"<<std::endl;
+        std::cout<<"Matmul x"<<count<<" batched: "<<count * rounds / batched * 1e-6<<" Mmat/s"<<std::endl;
+        std::cout<<"Matmul x"<<count<<" batched with conversion: "<<count * rounds / converted * 1e-6<<" Mmat/s"<<std::endl;
+    }
+}
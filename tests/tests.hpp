@@ -17,11 +17,32 @@ namespace mathtests {
     void test_float4x4_matmul();
     void test_float4x4_vecmul();
 
+    void test_float2x2_matmul();
+    void test_float3x3_matmul();
+    void test_float3x3_svd();
+    void test_float3x3_polar();
+
+    void test_batched_solve();
+    void test_batched_least_squares();
+
+    void test_random_fill();
+
+    void test_morton_order();
+
+    void test_float4x4_batch_matmul();
+
+    void test_batch_kernels();
+    void test_profile();
+
+    void test_stream_pipeline();
+
     void test_float4_cross();
 
     void benchmark_simd_dot();
 
     void benchmark_simd_cross();
+
+    void benchmark_batched_matmul();
 }
 
 #endif //MATHEMATICS_TESTS_HPP